@@ -17,9 +17,21 @@ source_group("${RPPLUGINS_ID}" FILES ${${PROJECT_NAME}_header_root})
 # list source
 set(${PROJECT_NAME}_source_root
     "${PROJECT_SOURCE_DIR}/src/config_openvr.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_blue_noise.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_blue_noise.hpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_camera_interface.cpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_controller.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_cull_frustum.hpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_event_dispatcher.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_event_dispatcher.hpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_frame_updater.hpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_plugin.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_pose_conversion.hpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_pose_sampler.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_pose_sampler.hpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_render_model_conversion.hpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_render_model_loader.cpp"
+    "${PROJECT_SOURCE_DIR}/src/openvr_render_model_loader.hpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_render_stage.cpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_render_stage.hpp"
 )
@@ -24,7 +24,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+
 #include <camera.h>
+#include <texture.h>
 
 #include <rpplugins/openvr/plugin.hpp>
 
@@ -32,6 +38,14 @@ namespace rpplugins {
 
 class OpenVRCameraInterface
 {
+public:
+    /** Frame of streaming thread. */
+    struct StreamFrame
+    {
+        vr::CameraVideoStreamFrameHeader_t header;
+        std::vector<uint8_t> buffer;                ///< RGBA data from top row.
+    };
+
 public:
     OpenVRCameraInterface(OpenVRPlugin& plugin);
     OpenVRCameraInterface(const OpenVRCameraInterface&) = delete;
@@ -112,10 +126,89 @@ public:
     virtual bool update_camera_node(Camera* cam, uint32_t camera_index, const LVecBase2& near_far = LVecBase2(0),
         vr::EVRTrackedCameraFrameType frame_type = vr::VRTrackedCameraFrameType_Undistorted) const;
 
+    /**
+     * Start streaming thread.
+     *
+     * The thread watches the sequence of frame header and fetches only new frames
+     * into reused buffers. Video streaming service will be acquired if it is not started.
+     */
+    virtual bool start_streaming(vr::EVRTrackedCameraFrameType frame_type=vr::VRTrackedCameraFrameType_Undistorted);
+
+    /** Stop streaming thread. */
+    virtual void stop_streaming();
+
+    bool is_streaming() const;
+
+    /**
+     * Get the latest frame of streaming thread.
+     *
+     * The frame is not changed by streaming thread until next call of this function.
+     *
+     * @param[out]  is_new  True if the frame is changed since previous call.
+     * @return      The latest frame or nullptr if no frame is received yet.
+     */
+    virtual const StreamFrame* get_latest_frame(bool* is_new=nullptr);
+
+    /**
+     * Get texture of the latest frame of streaming thread.
+     *
+     * The same texture is reused, and the image is uploaded only if there is new frame.
+     * Note that the image is upside down, because the frame starts from top row.
+     */
+    virtual Texture* get_frame_texture();
+
+    /** Clear cached frame sizes, intrinsics and projections. */
+    void clear_cache();
+
 private:
+    void stream_frames(vr::EVRTrackedCameraFrameType frame_type);
+
     OpenVRPlugin& plugin_;
+
+    // cache of runtime queries. It is cleared when properties of HMD are changed.
+    struct FrameSizeCache
+    {
+        vr::EVRTrackedCameraFrameType frame_type;
+        uint32_t width;
+        uint32_t height;
+        uint32_t buffer_size;
+    };
+    struct IntrinsicsCache
+    {
+        uint32_t camera_index;
+        vr::EVRTrackedCameraFrameType frame_type;
+        LVecBase2 focal_length;
+        LVecBase2 center;
+    };
+    struct ProjectionCache
+    {
+        uint32_t camera_index;
+        vr::EVRTrackedCameraFrameType frame_type;
+        LVecBase2 near_far;
+        LMatrix4 projection_matrix;
+    };
+    mutable std::vector<FrameSizeCache> frame_size_cache_;
+    mutable std::vector<IntrinsicsCache> intrinsics_cache_;
+    mutable std::vector<ProjectionCache> projection_cache_;
+    std::vector<std::pair<vr::EVREventType, size_t>> vr_event_handler_ids_;
+
     vr::IVRTrackedCamera* camera_instance_;
     vr::TrackedCameraHandle_t camera_handle_ = INVALID_TRACKED_CAMERA_HANDLE;
+
+    std::thread stream_thread_;
+    std::atomic<bool> streaming_{ false };
+
+    // lock-free triple buffer: streaming thread writes to back frame and swaps it with middle frame,
+    // and consumer swaps front frame with middle frame if the middle is new one.
+    static constexpr uint8_t NEW_FRAME_BIT = 0x4;
+    std::array<StreamFrame, 3> stream_frames_;
+    std::atomic<uint8_t> middle_frame_index_{ 2 };
+    uint8_t back_frame_index_ = 0;
+    uint8_t front_frame_index_ = 1;
+    bool has_front_frame_ = false;
+
+    PT(Texture) frame_texture_;
+    uint32_t frame_texture_sequence_ = 0;
 };
 
 // ************************************************************************************************
@@ -130,10 +223,22 @@ inline OpenVRCameraInterface::OpenVRCameraInterface(OpenVRPlugin& plugin) : plug
     plugin_.debug("OpenVR Camera Firmware: " + firmware_desc);
 
     camera_instance_ = vr::VRTrackedCamera();
+
+    for (const auto event_type : { vr::VREvent_PropertyChanged, vr::VREvent_TrackedDeviceUpdated })
+    {
+        vr_event_handler_ids_.push_back({ event_type, plugin_.add_vr_event_handler(event_type, [this](const vr::VREvent_t& ev) {
+            if (ev.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd)
+                clear_cache();
+        }) });
+    }
 }
 
 inline OpenVRCameraInterface::~OpenVRCameraInterface()
 {
+    for (const auto& id : vr_event_handler_ids_)
+        plugin_.remove_vr_event_handler(id.first, id.second);
+
+    stop_streaming();
     release_video_streaming_service();
 }
 
@@ -176,6 +281,8 @@ inline void OpenVRCameraInterface::release_video_streaming_service()
 {
     if (camera_instance_ && camera_handle_)
     {
+        stop_streaming();
+
         plugin_.debug("Release video streaming service.");
 
         camera_instance_->ReleaseVideoStreamingService(camera_handle_);
@@ -185,13 +292,37 @@ inline void OpenVRCameraInterface::release_video_streaming_service()
 
 inline vr::EVRTrackedCameraError OpenVRCameraInterface::get_frame_size(uint32_t& width, uint32_t& height, uint32_t& buffer_size, vr::EVRTrackedCameraFrameType frame_type) const
 {
-    return camera_instance_->GetCameraFrameSize(vr::k_unTrackedDeviceIndex_Hmd, frame_type,
+    for (const auto& cache : frame_size_cache_)
+    {
+        if (cache.frame_type == frame_type)
+        {
+            width = cache.width;
+            height = cache.height;
+            buffer_size = cache.buffer_size;
+            return vr::VRTrackedCameraError_None;
+        }
+    }
+
+    auto err = camera_instance_->GetCameraFrameSize(vr::k_unTrackedDeviceIndex_Hmd, frame_type,
         &width, &height, &buffer_size);
+    if (err == vr::VRTrackedCameraError_None)
+        frame_size_cache_.push_back({ frame_type, width, height, buffer_size });
+    return err;
 }
 
 inline vr::EVRTrackedCameraError OpenVRCameraInterface::get_intrinsics(uint32_t camera_index, LVecBase2& focal_length, LVecBase2& center,
     vr::EVRTrackedCameraFrameType frame_type) const
 {
+    for (const auto& cache : intrinsics_cache_)
+    {
+        if (cache.camera_index == camera_index && cache.frame_type == frame_type)
+        {
+            focal_length = cache.focal_length;
+            center = cache.center;
+            return vr::VRTrackedCameraError_None;
+        }
+    }
+
     vr::HmdVector2_t f;
     vr::HmdVector2_t c;
     auto err = camera_instance_->GetCameraIntrinsics(vr::k_unTrackedDeviceIndex_Hmd, camera_index, frame_type, &f, &c);
@@ -199,6 +330,7 @@ inline vr::EVRTrackedCameraError OpenVRCameraInterface::get_intrinsics(uint32_t
     {
         focal_length.set(f.v[0], f.v[1]);
         center.set(c.v[0], c.v[1]);
+        intrinsics_cache_.push_back({ camera_index, frame_type, focal_length, center });
     }
     return err;
 }
@@ -206,10 +338,27 @@ inline vr::EVRTrackedCameraError OpenVRCameraInterface::get_intrinsics(uint32_t
 inline vr::EVRTrackedCameraError OpenVRCameraInterface::get_projection(uint32_t camera_index, const LVecBase2& near_far, LMatrix4& projection_matrix,
     vr::EVRTrackedCameraFrameType frame_type) const
 {
+    for (const auto& cache : projection_cache_)
+    {
+        if (cache.camera_index == camera_index && cache.frame_type == frame_type && cache.near_far == near_far)
+        {
+            projection_matrix = cache.projection_matrix;
+            return vr::VRTrackedCameraError_None;
+        }
+    }
+
     vr::HmdMatrix44_t mat;
     auto err = camera_instance_->GetCameraProjection(vr::k_unTrackedDeviceIndex_Hmd, camera_index, frame_type, near_far[0], near_far[1], &mat);
     if (err == vr::VRTrackedCameraError_None)
+    {
         OpenVRPlugin::convert_matrix(mat, projection_matrix);
+
+        // near and far can be changed frequently, so keep only the latest one.
+        projection_cache_.erase(std::remove_if(projection_cache_.begin(), projection_cache_.end(), [&](const ProjectionCache& cache) {
+            return cache.camera_index == camera_index && cache.frame_type == frame_type;
+        }), projection_cache_.end());
+        projection_cache_.push_back({ camera_index, frame_type, near_far, projection_matrix });
+    }
     return err;
 }
 
@@ -246,6 +395,18 @@ inline std::string OpenVRCameraInterface::get_firmware_description() const
     return desc;
 }
 
+inline void OpenVRCameraInterface::clear_cache()
+{
+    frame_size_cache_.clear();
+    intrinsics_cache_.clear();
+    projection_cache_.clear();
+}
+
+inline bool OpenVRCameraInterface::is_streaming() const
+{
+    return streaming_;
+}
+
 inline vr::IVRTrackedCamera* OpenVRCameraInterface::get_vr_tracked_camera() const
 {
     return camera_instance_;
@@ -24,17 +24,81 @@
 
 #pragma once
 
+#include <array>
+#include <bitset>
+#include <vector>
+
 #include <dataNode.h>
+#include <buttonEventList.h>
+#include <buttonHandle.h>
 
 #include <openvr.h>
 
 namespace rpplugins {
 
+/**
+ * States of connected controllers.
+ *
+ * This is transmitted to "controller_states" output of OpenVRController every frame
+ * and the values are valid in current frame.
+ */
+class OpenVRControllerStates : public TypedWritableReferenceCount
+{
+public:
+    bool is_connected(vr::TrackedDeviceIndex_t device_index) const;
+
+    /** Get state of the controller or nullptr if the controller is not connected. */
+    const vr::VRControllerState_t* get_state(vr::TrackedDeviceIndex_t device_index) const;
+
+    LVecBase2 get_axis(vr::TrackedDeviceIndex_t device_index, uint32_t axis_index) const;
+
+    bool is_button_pressed(vr::TrackedDeviceIndex_t device_index, vr::EVRButtonId button_id) const;
+    bool is_button_touched(vr::TrackedDeviceIndex_t device_index, vr::EVRButtonId button_id) const;
+
+private:
+    friend class OpenVRController;
+
+    std::array<vr::VRControllerState_t, vr::k_unMaxTrackedDeviceCount> states_;
+    std::bitset<vr::k_unMaxTrackedDeviceCount> connected_;
+
+public:
+    static TypeHandle get_class_type();
+    static void init_type();
+    TypeHandle get_type() const override;
+    TypeHandle force_init_type() override;
+
+private:
+    static TypeHandle type_handle_;
+};
+
+// ************************************************************************************************
+
+/**
+ * Data node for OpenVR controllers.
+ *
+ * This polls states of only connected controllers and transmits the changes of buttons
+ * to "button_events" output as ButtonEventList, so ButtonThrower can be used to throw the events.
+ * The name of button is "openvr{device index}-{button name}" (ex, openvr3-steamvr_trigger).
+ *
+ * Axis values are transmitted to "controller_states" output as OpenVRControllerStates.
+ */
 class OpenVRController : public DataNode
 {
 public:
     OpenVRController(vr::IVRSystem* HMD);
 
+    /** Start to poll the device if the device is a controller. */
+    virtual void add_device(vr::TrackedDeviceIndex_t device_index);
+
+    /** Stop to poll the device. */
+    virtual void remove_device(vr::TrackedDeviceIndex_t device_index);
+
+    const std::vector<vr::TrackedDeviceIndex_t>& get_connected_devices() const;
+    const OpenVRControllerStates* get_states() const;
+
+    /** Get the handle of button of the device. */
+    virtual ButtonHandle get_button(vr::TrackedDeviceIndex_t device_index, vr::EVRButtonId button_id);
+
 protected:
     void do_transmit_data(DataGraphTraverser* trav,
         const DataNodeTransmit& input,
@@ -43,6 +107,14 @@ protected:
 private:
     vr::IVRSystem* const HMD_;
 
+    std::vector<vr::TrackedDeviceIndex_t> connected_devices_;
+    std::array<std::array<ButtonHandle, vr::k_EButton_Max>, vr::k_unMaxTrackedDeviceCount> buttons_;
+
+    int button_events_output_;
+    int states_output_;
+    PT(ButtonEventList) button_events_;
+    PT(OpenVRControllerStates) states_;
+
 public:
     static TypeHandle get_class_type();
     static void init_type();
@@ -55,9 +127,67 @@ private:
 
 // ************************************************************************************************
 
-inline OpenVRController::OpenVRController(vr::IVRSystem* HMD) :
-    DataNode("OpenVRController"), HMD_(HMD)
+inline bool OpenVRControllerStates::is_connected(vr::TrackedDeviceIndex_t device_index) const
+{
+    return device_index < vr::k_unMaxTrackedDeviceCount && connected_[device_index];
+}
+
+inline const vr::VRControllerState_t* OpenVRControllerStates::get_state(vr::TrackedDeviceIndex_t device_index) const
+{
+    return is_connected(device_index) ? &states_[device_index] : nullptr;
+}
+
+inline LVecBase2 OpenVRControllerStates::get_axis(vr::TrackedDeviceIndex_t device_index, uint32_t axis_index) const
+{
+    if (!is_connected(device_index) || axis_index >= vr::k_unControllerStateAxisCount)
+        return LVecBase2(0);
+
+    const auto& axis = states_[device_index].rAxis[axis_index];
+    return LVecBase2(axis.x, axis.y);
+}
+
+inline bool OpenVRControllerStates::is_button_pressed(vr::TrackedDeviceIndex_t device_index, vr::EVRButtonId button_id) const
+{
+    return is_connected(device_index) && (states_[device_index].ulButtonPressed & vr::ButtonMaskFromId(button_id));
+}
+
+inline bool OpenVRControllerStates::is_button_touched(vr::TrackedDeviceIndex_t device_index, vr::EVRButtonId button_id) const
+{
+    return is_connected(device_index) && (states_[device_index].ulButtonTouched & vr::ButtonMaskFromId(button_id));
+}
+
+inline TypeHandle OpenVRControllerStates::get_class_type()
+{
+    return type_handle_;
+}
+
+inline void OpenVRControllerStates::init_type()
+{
+    TypedWritableReferenceCount::init_type();
+    register_type(type_handle_, "rpplugins::OpenVRControllerStates", TypedWritableReferenceCount::get_class_type());
+}
+
+inline TypeHandle OpenVRControllerStates::get_type() const
+{
+    return get_class_type();
+}
+
+inline TypeHandle OpenVRControllerStates::force_init_type()
+{
+    init_type();
+    return get_class_type();
+}
+
+// ************************************************************************************************
+
+inline const std::vector<vr::TrackedDeviceIndex_t>& OpenVRController::get_connected_devices() const
+{
+    return connected_devices_;
+}
+
+inline const OpenVRControllerStates* OpenVRController::get_states() const
 {
+    return states_;
 }
 
 inline TypeHandle OpenVRController::get_class_type()
@@ -24,6 +24,10 @@
 
 #pragma once
 
+#include <array>
+#include <functional>
+#include <future>
+
 #include <render_pipeline/rppanda/showbase/direct_object.hpp>
 #include <render_pipeline/rpcore/pluginbase/base_plugin.hpp>
 
@@ -39,6 +43,11 @@ class OpenVRPlugin : public rpcore::BasePlugin, public rppanda::DirectObject
 {
 public:
     static const int UPDATE_TASK_SORT = -60;
+    static const int LATE_LATCH_TASK_SORT = 5;
+    static const size_t FRAME_TIMING_HISTORY_SIZE = 256;
+    static const size_t POSE_SAMPLE_QUEUE_SIZE = 256;
+
+    using VREventHandler = std::function<void(const vr::VREvent_t&)>;
 
     static LMatrix4 convert_matrix(const vr::HmdMatrix34_t& from);
     static LMatrix4 convert_matrix(const vr::HmdMatrix44_t& from);
@@ -47,6 +56,18 @@ public:
     static void convert_matrix(const LMatrix4& from, vr::HmdMatrix34_t& to);
     static void convert_matrix(const LMatrix4& from, vr::HmdMatrix44_t& to);
 
+    /**
+     * Convert the pose of OpenVR (Y-up) to the matrix of Panda3D (Z-up).
+     *
+     * The result is same as `z_to_y_up_mat() * convert_matrix(from) * y_to_z_up_mat()`
+     * with the translation scaled by @p distance_scale, but the change of axes is applied
+     * as permutation and sign flip instead of matrix multiplications.
+     */
+    static void convert_pose_matrix(const vr::HmdMatrix34_t& from, LMatrix4& to, float distance_scale=1.0f);
+
+    /** Convert the poses of OpenVR to the matrices of Panda3D in one pass. See convert_pose_matrix. */
+    static void convert_pose_matrices(const vr::TrackedDevicePose_t* from, LMatrix4* to, size_t count, float distance_scale=1.0f);
+
 public:
     enum class SupersampleMode
     {
@@ -55,6 +76,40 @@ public:
         ignore_mode,
     };
 
+    /** Statistics of updating device nodes. */
+    struct DeviceUpdateStats
+    {
+        size_t updated_count = 0;           ///< The number of updated nodes in last frame.
+        size_t skipped_count = 0;           ///< The number of skipped (stationary) nodes in last frame.
+        uint64_t total_updated_count = 0;
+        uint64_t total_skipped_count = 0;
+    };
+
+    /** Timing of a frame in OpenVR compositor. */
+    struct FrameTiming
+    {
+        uint32_t frame_index = 0;
+        float cpu_frame_ms = 0;             ///< CPU time from new poses to submitting the frame.
+        float gpu_frame_ms = 0;             ///< GPU time of application to render the frame.
+        float submit_to_present_ms = 0;     ///< Time from submitting the frame to finishing rendering of compositor.
+        uint32_t dropped_frames = 0;        ///< The number of frames which were dropped before this frame.
+        uint32_t reprojected_frames = 0;    ///< The number of additional presents of this frame by reprojection.
+    };
+
+    struct FrameTimingTotals
+    {
+        uint64_t frame_count = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t reprojected_frames = 0;
+    };
+
+    /** Pose of tracked device sampled by pose sampler. */
+    struct PoseSample
+    {
+        uint64_t timestamp_ns = 0;          ///< Time of std::chrono::steady_clock in nanoseconds.
+        vr::TrackedDevicePose_t pose;
+    };
+
 public:
     OpenVRPlugin(rpcore::RenderPipeline& pipeline);
     ~OpenVRPlugin() override;
@@ -72,6 +127,15 @@ public:
     virtual NodePath load_model(const std::string& model_name) const;
     virtual NodePath load_model(vr::TrackedDeviceIndex_t unTrackedDeviceIndex) const;
 
+    /**
+     * Load render model without blocking.
+     *
+     * Loading is processed in worker thread and the returned node is empty placeholder.
+     * The model will be attached to the placeholder in update task when loading is finished.
+     * Geom and Texture are shared among the models with the same name.
+     */
+    virtual NodePath load_model_async(const std::string& model_name);
+
     virtual NodePath setup_device_node(vr::TrackedDeviceIndex_t unTrackedDeviceIndex);
     virtual NodePath setup_render_model(vr::TrackedDeviceIndex_t unTrackedDeviceIndex);
 
@@ -114,6 +178,44 @@ public:
      */
     virtual void set_distance_scale(float distance_scale);
 
+    /**
+     * Get statistics of updating device nodes.
+     *
+     * The transform of device node is skipped if the changes of the pose are less than
+     * "device_position_epsilon" and "device_orientation_epsilon".
+     */
+    virtual const DeviceUpdateStats& get_device_update_stats() const;
+
+    /**
+     * Get recent frame timings of OpenVR compositor.
+     *
+     * The timings are collected in update task every frame and
+     * the last FRAME_TIMING_HISTORY_SIZE timings are kept.
+     * This can be called from other threads.
+     *
+     * @param[out]  timings     The timings ordered from oldest to newest.
+     */
+    virtual void get_frame_timings(std::vector<FrameTiming>& timings) const;
+
+    /** Get accumulated counts of frame timings. This can be called from other threads. */
+    virtual FrameTimingTotals get_frame_timing_totals() const;
+
+    /**
+     * Move the poses of the device sampled by pose sampler to @p samples.
+     *
+     * If "pose_sampling_rate" is not 0, the poses of all devices are sampled in a worker thread
+     * at the rate, and queued by device. The queue has POSE_SAMPLE_QUEUE_SIZE samples at most
+     * and new samples are dropped while the queue is full.
+     *
+     * This can be called from other threads, but only one thread should drain the same device.
+     *
+     * @return  The number of appended samples.
+     */
+    virtual size_t drain_pose_samples(vr::TrackedDeviceIndex_t device_index, std::vector<PoseSample>& samples);
+
+    /** Get the number of samples dropped because the queues were full. */
+    virtual uint64_t get_dropped_pose_sample_count() const;
+
     virtual const vr::TrackedDevicePose_t& get_tracked_device_pose(vr::TrackedDeviceIndex_t device_index) const;
     virtual vr::ETrackedDeviceClass get_tracked_device_class(vr::TrackedDeviceIndex_t device_index) const;
 
@@ -121,13 +223,36 @@ public:
 
     virtual bool has_tracked_camera() const;
 
+    /**
+     * Get the size of play area in meter.
+     *
+     * The size is cached and updated by VREvent_ChaperoneDataHasChanged and VREvent_ChaperoneUniverseHasChanged.
+     */
     virtual boost::optional<LVecBase2> get_play_area_size() const;
 
+    /** Get the corners of play area in Z-up coordinates (meter). This is cached like get_play_area_size. */
+    virtual boost::optional<std::array<LPoint3, 4>> get_play_area_rect() const;
+
+    /**
+     * Get the node having line strip of play area bounds.
+     *
+     * The node is created under the group of device nodes (scaled by distance scale) at first call,
+     * and the geometry is rebuilt only when chaperone is changed.
+     * If chaperone is not ready, the geometry is empty until it is ready.
+     */
+    virtual NodePath get_play_area_node();
+
     /**
      * Get instance for tracking camera in HMD.
      */
     virtual OpenVRCameraInterface* get_tracked_camera();
 
+    /**
+     * Get the property of tracked device.
+     *
+     * Results are cached per device and property, and the cache is not synchronized.
+     * So, these functions should be called in the main thread only.
+     */
     virtual bool get_tracked_device_property(std::string& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const;
     virtual bool get_tracked_device_property(bool& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const;
     virtual bool get_tracked_device_property(int32_t& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const;
@@ -135,6 +260,14 @@ public:
     virtual bool get_tracked_device_property(float& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const;
     virtual bool get_tracked_device_property(LMatrix4& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const;
 
+    /**
+     * Get the string property of tracked device without copying the string.
+     *
+     * The reference points to the cache, so it is valid until the cache of the property is cleared
+     * (ex, VREvent_PropertyChanged or deactivation of the device) in the update task.
+     */
+    virtual boost::optional<const std::string&> get_tracked_device_string_property(vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const;
+
     /**
      * Take stereo screenshots.
      *
@@ -146,6 +279,38 @@ public:
      */
     virtual vr::EVRScreenshotError take_stereo_screenshots(const Filename& preview_file_path, const Filename& vr_file_path) const;
 
+    /**
+     * Capture stereo screenshots from the eye targets of this plugin without VRScreenshots API.
+     *
+     * The images are copied to RAM after rendering of next frame and written in a background thread,
+     * so this does not stall the frame. Multiple requests are captured in successive frames.
+     * The format of images is chosen by the extension of path (ex, png, jpg).
+     * This is not supported in "texture_array" submit mode.
+     *
+     * @param   preview_file_path   The file path of preview image (left eye image).
+     * @param   vr_file_path        The file path of stereo image (left and right eye images side by side).
+     * @return  The future which is true if both images are written.
+     */
+    virtual std::future<bool> capture_stereo_screenshots(const Filename& preview_file_path, const Filename& vr_file_path);
+
+    /**
+     * Add handler of OpenVR event.
+     *
+     * The handler is called directly with the event while processing OpenVR events in update task.
+     * If handlers are added or removed in a handler, the change is applied after the current event.
+     *
+     * @return  ID of the handler to remove it.
+     */
+    virtual size_t add_vr_event_handler(vr::EVREventType event_type, const VREventHandler& handler);
+
+    virtual void remove_vr_event_handler(vr::EVREventType event_type, size_t handler_id);
+
+    /**
+     * Get OpenVR events in current frame.
+     *
+     * If "send_vr_event_messages" is true, the index of event is sent as a parameter of
+     * messenger event whose name is the name of OpenVR event type (ex, VREvent_TrackedDeviceActivated).
+     */
     virtual const std::vector<vr::VREvent_t>& get_vr_events() const;
     virtual const vr::VREvent_t& get_vr_event(int index) const;
 
@@ -215,4 +380,22 @@ inline void OpenVRPlugin::convert_matrix(const LMatrix4& from, vr::HmdMatrix44_t
         } };
 }
 
+inline void OpenVRPlugin::convert_pose_matrix(const vr::HmdMatrix34_t& from, LMatrix4& to, float distance_scale)
+{
+    // Y-up (x, y, z) is Z-up (x, -z, y), so i-th row of the result is
+    // (1, -1, 1) * sign(i) * (column j of OpenVR matrix) with permuted rows (0, 2, 1).
+    to.set(
+        from.m[0][0], -from.m[2][0], from.m[1][0], 0.0f,
+        -from.m[0][2], from.m[2][2], -from.m[1][2], 0.0f,
+        from.m[0][1], -from.m[2][1], from.m[1][1], 0.0f,
+        from.m[0][3] * distance_scale, -from.m[2][3] * distance_scale, from.m[1][3] * distance_scale, 1.0f
+    );
+}
+
+inline void OpenVRPlugin::convert_pose_matrices(const vr::TrackedDevicePose_t* from, LMatrix4* to, size_t count, float distance_scale)
+{
+    for (size_t k = 0; k < count; ++k)
+        convert_pose_matrix(from[k].mDeviceToAbsoluteTracking, to[k], distance_scale);
+}
+
 }
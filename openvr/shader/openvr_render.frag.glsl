@@ -27,20 +27,30 @@
 #version 430
 
 #pragma include "render_pipeline_base.inc.glsl"
-#pragma include "includes/noise.inc.glsl"
 #pragma include "includes/color_spaces.inc.glsl"
 
 uniform sampler2DArray ShadedScene;
+uniform sampler2D BlueNoiseTex;
+uniform ivec2 blue_noise_offset;
+// eye index or -1 for side-by-side target
 uniform int vr_eye;
 
 out vec4 result;
 
 void main() {
-    vec2 texcoord = get_texcoord();
-    const ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    int eye = vr_eye;
+
+    // left half is left eye and right half is right eye.
+    if (eye < 0)
+    {
+        const int eye_width = int(SCREEN_SIZE.x);
+        eye = coord.x < eye_width ? 0 : 1;
+        coord.x -= eye * eye_width;
+    }
 
     // Fetch the current's scene color
-    vec3 scene_color = texelFetch(ShadedScene, ivec3(coord, vr_eye), 0).xyz;
+    vec3 scene_color = texelFetch(ShadedScene, ivec3(coord, eye), 0).xyz;
 
     #if !DEBUG_MODE && !HAVE_PLUGIN(color_correction)
         // Do a simple sRGB correction
@@ -50,7 +60,8 @@ void main() {
     // Apply dithering to prevent banding, since we are converting from 16 bit
     // precision to 8 bit precision here
     #if !REFERENCE_MODE
-        vec3 dither = (rand_rgb(texcoord) + rand_rgb(texcoord + 0.5787)) * 0.5 - 0.4;
+        const ivec2 noise_size = textureSize(BlueNoiseTex, 0);
+        vec3 dither = texelFetch(BlueNoiseTex, (ivec2(gl_FragCoord.xy) + blue_noise_offset) % noise_size, 0).xyz - 0.5;
         scene_color += dither / 128.0;
     #endif
 
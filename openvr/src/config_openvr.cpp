@@ -34,6 +34,8 @@ ConfigureFn(config_rpplugins_openvr)
         return;
     initialized = true;
 
+    rpplugins::OpenVRControllerStates::init_type();
     rpplugins::OpenVRController::init_type();
     rpplugins::SubmitCallback::init_type();
+    rpplugins::ArraySubmitCallback::init_type();
 }
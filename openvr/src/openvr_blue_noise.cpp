@@ -0,0 +1,179 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "openvr_blue_noise.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <virtualFileSystem.h>
+
+namespace rpplugins {
+
+PT(Texture) BlueNoiseTexture::load(int size, const Filename& cache_path)
+{
+    PNMImage image;
+    if (cache_path.empty() || !VirtualFileSystem::get_global_ptr()->exists(cache_path) ||
+        !image.read(cache_path) || image.get_x_size() != size || image.get_y_size() != size)
+    {
+        generate(image, size);
+        if (!cache_path.empty())
+            image.write(cache_path);
+    }
+
+    PT(Texture) tex = new Texture("blue_noise");
+    tex->load(image);
+    tex->set_minfilter(SamplerState::FT_nearest);
+    tex->set_magfilter(SamplerState::FT_nearest);
+    tex->set_wrap_u(SamplerState::WM_repeat);
+    tex->set_wrap_v(SamplerState::WM_repeat);
+
+    return tex;
+}
+
+void BlueNoiseTexture::generate(PNMImage& image, int size)
+{
+    image.clear(size, size, 3, 255);
+
+    const int count = size * size;
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        const auto ranks = generate_ranks(size, 1234u + channel);
+        for (int k = 0; k < count; ++k)
+            image.set_channel_val(k % size, k / size, channel, ranks[k] * 256 / count);
+    }
+}
+
+std::vector<int> BlueNoiseTexture::generate_ranks(int size, unsigned int seed)
+{
+    const int count = size * size;
+    const float sigma = 1.5f;
+
+    // gaussian weights of toroidal distance
+    std::vector<float> weights(count);
+    for (int y = 0; y < size; ++y)
+    {
+        const int dy = (std::min)(y, size - y);
+        for (int x = 0; x < size; ++x)
+        {
+            const int dx = (std::min)(x, size - x);
+            weights[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+    }
+
+    // energy of "1" pixels at each pixel
+    std::vector<float> energy(count, 0.0f);
+    std::vector<char> pattern(count, 0);
+
+    auto toggle = [&](int index) {
+        const float sign = pattern[index] ? -1.0f : 1.0f;
+        pattern[index] = !pattern[index];
+
+        const int ix = index % size;
+        const int iy = index / size;
+        for (int y = 0; y < size; ++y)
+        {
+            const int wy = ((y - iy + size) % size) * size;
+            for (int x = 0; x < size; ++x)
+                energy[y * size + x] += sign * weights[wy + (x - ix + size) % size];
+        }
+    };
+
+    // tightest cluster is "1" pixel with max energy and largest void is "0" pixel with min energy.
+    auto find_tightest_cluster = [&]() {
+        int found = -1;
+        for (int k = 0; k < count; ++k)
+        {
+            if (pattern[k] && (found < 0 || energy[k] > energy[found]))
+                found = k;
+        }
+        return found;
+    };
+
+    auto find_largest_void = [&]() {
+        int found = -1;
+        for (int k = 0; k < count; ++k)
+        {
+            if (!pattern[k] && (found < 0 || energy[k] < energy[found]))
+                found = k;
+        }
+        return found;
+    };
+
+    // initial binary pattern
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, count - 1);
+    const int initial_count = (std::max)(1, count / 10);
+    for (int ones = 0; ones < initial_count;)
+    {
+        const int index = dist(rng);
+        if (!pattern[index])
+        {
+            toggle(index);
+            ++ones;
+        }
+    }
+
+    // move points from clusters to voids until it converges.
+    for (int iteration = 0; iteration < count; ++iteration)
+    {
+        const int cluster = find_tightest_cluster();
+        toggle(cluster);
+        const int void_index = find_largest_void();
+        if (void_index == cluster)
+        {
+            toggle(cluster);
+            break;
+        }
+        toggle(void_index);
+    }
+
+    std::vector<int> ranks(count, 0);
+
+    // phase 1: rank the initial points by removing tightest clusters.
+    const auto initial_pattern = pattern;
+    const auto initial_energy = energy;
+    for (int rank = initial_count - 1; rank >= 0; --rank)
+    {
+        const int cluster = find_tightest_cluster();
+        toggle(cluster);
+        ranks[cluster] = rank;
+    }
+
+    // phase 2 and 3: fill the largest voids.
+    // the tightest cluster of "0" pixels is the same as the largest void of "1" pixels.
+    pattern = initial_pattern;
+    energy = initial_energy;
+    for (int rank = initial_count; rank < count; ++rank)
+    {
+        const int void_index = find_largest_void();
+        toggle(void_index);
+        ranks[void_index] = rank;
+    }
+
+    return ranks;
+}
+
+}
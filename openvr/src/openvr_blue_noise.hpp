@@ -0,0 +1,60 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <pnmImage.h>
+#include <texture.h>
+#include <filename.h>
+
+namespace rpplugins {
+
+/**
+ * Tileable blue noise texture for dithering.
+ *
+ * Each channel is generated independently by void-and-cluster method,
+ * so the channels are not correlated.
+ */
+class BlueNoiseTexture
+{
+public:
+    /**
+     * Load the texture from the cache file or generate it if the file does not exist.
+     *
+     * Generated texture is written to the cache file if the path is not empty.
+     */
+    static PT(Texture) load(int size, const Filename& cache_path);
+
+    /** Generate RGB blue noise image whose size is @p size x @p size. */
+    static void generate(PNMImage& image, int size);
+
+    /**
+     * Generate ranks of blue noise with void-and-cluster method.
+     *
+     * @return  Rank (0 ~ size*size-1) of each pixel in row-major order.
+     */
+    static std::vector<int> generate_ranks(int size, unsigned int seed);
+};
+
+}
@@ -24,6 +24,8 @@
 
 #include "rpplugins/openvr/camera_interface.hpp"
 
+#include <chrono>
+
 #include <matrixLens.h>
 
 #include <fmt/format.h>
@@ -69,11 +71,15 @@ bool OpenVRCameraInterface::update_camera_node(Camera* cam, uint32_t camera_inde
         }
 
         auto lens = DCAST(MatrixLens, cam_lens);
+        const LMatrix4 user_mat = LMatrix4::z_to_y_up_mat() * proj_mat;
+
+        // setting lens invalidates the lens, so skip it if nothing is changed.
+        if (lens->get_film_size() == LVecBase2(2, 2) && lens->get_user_mat() == user_mat)
+            return true;
 
         // OpenGL film (NDC) is [-1, 1] on zero origin.
         lens->set_film_size(2, 2);
-        lens->set_user_mat(
-            LMatrix4::z_to_y_up_mat() * proj_mat);
+        lens->set_user_mat(user_mat);
     }
     else if (cam_lens->is_of_type(PerspectiveLens::get_class_type()))
     {
@@ -94,14 +100,23 @@ bool OpenVRCameraInterface::update_camera_node(Camera* cam, uint32_t camera_inde
             return false;
         }
 
+        auto lens = DCAST(PerspectiveLens, cam_lens);
+        const LVecBase2 film_size(width, height);
+        const LVecBase2 film_offset(width / 2.0f - center[0], center[1] - height / 2.0f);
+        if (lens->get_near() == vr_near_far[0] && lens->get_far() == vr_near_far[1] &&
+            lens->get_film_size() == film_size && lens->get_focal_length() == focal_length[0] &&
+            lens->get_film_offset() == film_offset)
+        {
+            return true;
+        }
+
         if (focal_length[0] != focal_length[1])
             plugin_.warn("X and Y of focal length are NOT same.");
 
-        auto lens = DCAST(PerspectiveLens, cam_lens);
         lens->set_near_far(vr_near_far[0], vr_near_far[1]);
-        lens->set_film_size(width, height);
+        lens->set_film_size(film_size);
         lens->set_focal_length(focal_length[0]);
-        lens->set_film_offset(width / 2.0f - center[0], center[1] - height / 2.0f);
+        lens->set_film_offset(film_offset);
     }
     else
     {
@@ -112,4 +127,138 @@ bool OpenVRCameraInterface::update_camera_node(Camera* cam, uint32_t camera_inde
     return true;
 }
 
+bool OpenVRCameraInterface::start_streaming(vr::EVRTrackedCameraFrameType frame_type)
+{
+    if (streaming_)
+    {
+        plugin_.warn("Streaming thread was started already.");
+        return true;
+    }
+
+    if (!acquire_video_streaming_service())
+        return false;
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t buffer_size;
+    if (get_frame_size(width, height, buffer_size, frame_type) != vr::VRTrackedCameraError_None)
+    {
+        plugin_.error("Failed to get camera frame size.");
+        return false;
+    }
+
+    // buffers are allocated once and reused.
+    for (auto& frame : stream_frames_)
+    {
+        frame.header = vr::CameraVideoStreamFrameHeader_t{};
+        frame.buffer.resize(buffer_size);
+    }
+    middle_frame_index_ = 2;
+    back_frame_index_ = 0;
+    front_frame_index_ = 1;
+    has_front_frame_ = false;
+
+    plugin_.debug(fmt::format("Start camera streaming thread ({} x {}).", width, height));
+
+    streaming_ = true;
+    stream_thread_ = std::thread(&OpenVRCameraInterface::stream_frames, this, frame_type);
+
+    return true;
+}
+
+void OpenVRCameraInterface::stop_streaming()
+{
+    streaming_ = false;
+    if (stream_thread_.joinable())
+    {
+        stream_thread_.join();
+        plugin_.debug("Camera streaming thread is stopped.");
+    }
+}
+
+const OpenVRCameraInterface::StreamFrame* OpenVRCameraInterface::get_latest_frame(bool* is_new)
+{
+    const bool has_new_frame = (middle_frame_index_.load(std::memory_order_relaxed) & NEW_FRAME_BIT) != 0;
+    if (has_new_frame)
+    {
+        front_frame_index_ = static_cast<uint8_t>(middle_frame_index_.exchange(front_frame_index_, std::memory_order_acq_rel) & ~NEW_FRAME_BIT);
+        has_front_frame_ = true;
+    }
+
+    if (is_new)
+        *is_new = has_new_frame;
+
+    return has_front_frame_ ? &stream_frames_[front_frame_index_] : nullptr;
+}
+
+Texture* OpenVRCameraInterface::get_frame_texture()
+{
+    const StreamFrame* frame = get_latest_frame();
+    if (!frame)
+        return frame_texture_;
+
+    if (frame_texture_ && frame_texture_sequence_ == frame->header.nFrameSequence)
+        return frame_texture_;
+
+    const int width = static_cast<int>(frame->header.nWidth);
+    const int height = static_cast<int>(frame->header.nHeight);
+
+    if (!frame_texture_)
+        frame_texture_ = new Texture("openvr_tracked_camera");
+
+    if (frame_texture_->get_x_size() != width || frame_texture_->get_y_size() != height)
+        frame_texture_->setup_2d_texture(width, height, Texture::T_unsigned_byte, Texture::F_rgba8);
+
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+    if (frame->buffer.size() < pixel_count * 4)
+        return frame_texture_;
+
+    // Panda3D uses BGRA order in RAM image.
+    PTA_uchar image = frame_texture_->modify_ram_image();
+    const uint8_t* src = frame->buffer.data();
+    unsigned char* dest = image.p();
+    for (size_t k = 0; k < pixel_count; ++k, src += 4, dest += 4)
+    {
+        dest[0] = src[2];
+        dest[1] = src[1];
+        dest[2] = src[0];
+        dest[3] = src[3];
+    }
+
+    frame_texture_sequence_ = frame->header.nFrameSequence;
+
+    return frame_texture_;
+}
+
+void OpenVRCameraInterface::stream_frames(vr::EVRTrackedCameraFrameType frame_type)
+{
+    uint32_t last_sequence = 0;
+    vr::CameraVideoStreamFrameHeader_t header;
+
+    while (streaming_)
+    {
+        // fetch buffer only when the frame is changed.
+        if (get_frame_header(header, frame_type) != vr::VRTrackedCameraError_None || header.nFrameSequence == last_sequence)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        auto& frame = stream_frames_[back_frame_index_];
+        if (camera_instance_->GetVideoStreamFrameBuffer(camera_handle_, frame_type, frame.buffer.data(),
+            static_cast<uint32_t>(frame.buffer.size()), &frame.header, sizeof(vr::CameraVideoStreamFrameHeader_t)) != vr::VRTrackedCameraError_None)
+        {
+            // do not spin when the buffer keeps failing.
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        last_sequence = frame.header.nFrameSequence;
+
+        // publish
+        back_frame_index_ = static_cast<uint8_t>(middle_frame_index_.exchange(
+            static_cast<uint8_t>(back_frame_index_ | NEW_FRAME_BIT), std::memory_order_acq_rel) & ~NEW_FRAME_BIT);
+    }
+}
+
 }
@@ -24,43 +24,114 @@
 
 #include "rpplugins/openvr/controller.hpp"
 
+#include <algorithm>
+#include <cctype>
+
+#include <buttonRegistry.h>
+
+#include <fmt/format.h>
+
 namespace rpplugins {
 
+TypeHandle OpenVRControllerStates::type_handle_;
 TypeHandle OpenVRController::type_handle_;
 
+OpenVRController::OpenVRController(vr::IVRSystem* HMD) :
+    DataNode("OpenVRController"), HMD_(HMD)
+{
+    button_events_output_ = define_output("button_events", ButtonEventList::get_class_type());
+    states_output_ = define_output("controller_states", OpenVRControllerStates::get_class_type());
+
+    button_events_ = new ButtonEventList;
+    states_ = new OpenVRControllerStates;
+
+    connected_devices_.reserve(vr::k_unMaxTrackedDeviceCount);
+}
+
+void OpenVRController::add_device(vr::TrackedDeviceIndex_t device_index)
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount || states_->connected_[device_index])
+        return;
+
+    if (HMD_->GetTrackedDeviceClass(device_index) != vr::TrackedDeviceClass_Controller)
+        return;
+
+    states_->states_[device_index] = vr::VRControllerState_t{};
+    states_->connected_[device_index] = true;
+    connected_devices_.push_back(device_index);
+}
+
+void OpenVRController::remove_device(vr::TrackedDeviceIndex_t device_index)
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount || !states_->connected_[device_index])
+        return;
+
+    states_->connected_[device_index] = false;
+    connected_devices_.erase(std::remove(connected_devices_.begin(), connected_devices_.end(), device_index), connected_devices_.end());
+}
+
+ButtonHandle OpenVRController::get_button(vr::TrackedDeviceIndex_t device_index, vr::EVRButtonId button_id)
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount || button_id >= vr::k_EButton_Max)
+        return ButtonHandle::none();
+
+    auto& button = buttons_[device_index][button_id];
+    if (button == ButtonHandle::none())
+    {
+        // ex) k_EButton_SteamVR_Trigger -> steamvr_trigger
+        std::string button_name = HMD_->GetButtonIdNameFromEnum(button_id);
+        const std::string prefix = "k_EButton_";
+        if (button_name.compare(0, prefix.length(), prefix) == 0)
+            button_name.erase(0, prefix.length());
+        std::transform(button_name.begin(), button_name.end(), button_name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        button = ButtonRegistry::ptr()->get_button(fmt::format("openvr{}-{}", device_index, button_name));
+    }
+
+    return button;
+}
+
 void OpenVRController::do_transmit_data(DataGraphTraverser* trav,
     const DataNodeTransmit&,
     DataNodeTransmit& output)
 {
-    // Process SteamVR controller state
-    for (vr::TrackedDeviceIndex_t index = 0; index < vr::k_unMaxTrackedDeviceCount; ++index)
+    // reuse the list if previous list is not used by others.
+    if (button_events_->get_ref_count() > 1)
+        button_events_ = new ButtonEventList;
+    else
+        button_events_->clear();
+
+    // Process SteamVR controller state of connected controllers.
+    for (const auto device_index : connected_devices_)
     {
         vr::VRControllerState_t state;
-        if (!HMD_->GetControllerState(index, &state, sizeof(state)))
+        if (!HMD_->GetControllerState(device_index, &state, sizeof(state)))
             continue;
 
-        if (state.ulButtonPressed & vr::ButtonMaskFromId(vr::EVRButtonId::k_EButton_System))
-        {
-        }
+        auto& prev_state = states_->states_[device_index];
+        if (state.unPacketNum == prev_state.unPacketNum)
+            continue;
 
-        if (state.ulButtonPressed & vr::ButtonMaskFromId(vr::EVRButtonId::k_EButton_ApplicationMenu))
+        uint64_t changed = state.ulButtonPressed ^ prev_state.ulButtonPressed;
+        for (uint32_t button_id = 0; changed; ++button_id, changed >>= 1)
         {
-        }
+            if (!(changed & 1))
+                continue;
 
-        if (state.ulButtonPressed & vr::ButtonMaskFromId(vr::EVRButtonId::k_EButton_Grip))
-        {
+            const auto button = get_button(device_index, static_cast<vr::EVRButtonId>(button_id));
+            if (state.ulButtonPressed & vr::ButtonMaskFromId(static_cast<vr::EVRButtonId>(button_id)))
+                button_events_->add_event(ButtonEvent(button, ButtonEvent::T_down));
+            else
+                button_events_->add_event(ButtonEvent(button, ButtonEvent::T_up));
         }
 
-        for (uint32_t k = 0; k < vr::k_unControllerStateAxisCount; ++k)
-        {
-            auto button_id = static_cast<vr::EVRButtonId>(vr::EVRButtonId::k_EButton_Axis0 + k);
+        prev_state = state;
+    }
 
-            if (state.ulButtonPressed & vr::ButtonMaskFromId(button_id))
-            {
+    if (button_events_->get_num_events() > 0)
+        output.set_data(button_events_output_, EventParameter(button_events_));
 
-            }
-        }
-    }
+    output.set_data(states_output_, EventParameter(states_));
 }
 
 }
@@ -0,0 +1,120 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include <luse.h>
+
+namespace rpplugins {
+
+/** Mono frustum for culling which contains the frusta of both eyes. */
+struct OpenVRCullFrustum
+{
+    LMatrix4 proj_mat;      ///< Transposed OpenGL projection matrix like OpenVRPlugin::convert_matrix.
+    float offset;           ///< Distance from head to the apex of the frustum (backward).
+};
+
+/**
+ * Compute the culling frustum from the projections and eye-to-head matrices of both eyes.
+ *
+ * The matrices are transposed OpenVR matrices (OpenVRPlugin::convert_matrix) in head space (Y-up),
+ * and eye-to-head matrices can have rotation for canted displays.
+ *
+ * The apex of the culling frustum is on the Z-axis behind the head,
+ * and it is moved backward until the frustum contains the corners of both eye frusta.
+ */
+inline OpenVRCullFrustum compute_cull_frustum(
+    const LMatrix4& left_proj_mat, const LMatrix4& left_eye_to_head,
+    const LMatrix4& right_proj_mat, const LMatrix4& right_eye_to_head,
+    float near_dist, float far_dist)
+{
+    struct Tangents { float left, right, bottom, top; };
+    Tangents combined = { 0, 0, 0, 0 };
+
+    std::array<LPoint3, 16> corners;
+    size_t corner_count = 0;
+
+    for (const auto& eye : { std::make_pair(&left_proj_mat, &left_eye_to_head), std::make_pair(&right_proj_mat, &right_eye_to_head) })
+    {
+        const LMatrix4& proj = *eye.first;
+        const LMatrix4& eye_to_head = *eye.second;
+
+        // tangents of frustum from OpenGL projection matrix (transposed).
+        const Tangents tangents = {
+            (proj(2, 0) - 1) / proj(0, 0), (proj(2, 0) + 1) / proj(0, 0),
+            (proj(2, 1) - 1) / proj(1, 1), (proj(2, 1) + 1) / proj(1, 1) };
+
+        for (const float tan_x : { tangents.left, tangents.right })
+        {
+            for (const float tan_y : { tangents.bottom, tangents.top })
+            {
+                // tangents of the edge in head space
+                const LVector3 edge = eye_to_head.xform_vec(LVector3(tan_x, tan_y, -1));
+                combined.left = (std::min)(combined.left, edge[0] / -edge[2]);
+                combined.right = (std::max)(combined.right, edge[0] / -edge[2]);
+                combined.bottom = (std::min)(combined.bottom, edge[1] / -edge[2]);
+                combined.top = (std::max)(combined.top, edge[1] / -edge[2]);
+
+                for (const float dist : { near_dist, far_dist })
+                    corners[corner_count++] = eye_to_head.xform_point(LPoint3(tan_x * dist, tan_y * dist, -dist));
+            }
+        }
+    }
+
+    // move apex backward until the corners are inside of the tangents from the apex.
+    // ex) x <= right * (offset - z)  =>  offset >= x / right + z
+    float offset = 0;
+    for (const LPoint3& corner : corners)
+    {
+        offset = (std::max)(offset, corner[0] / (corner[0] < 0 ? combined.left : combined.right) + corner[2]);
+        offset = (std::max)(offset, corner[1] / (corner[1] < 0 ? combined.bottom : combined.top) + corner[2]);
+    }
+
+    float cull_near = offset - corners[0][2];
+    float cull_far = cull_near;
+    for (const LPoint3& corner : corners)
+    {
+        cull_near = (std::min)(cull_near, offset - corner[2]);
+        cull_far = (std::max)(cull_far, offset - corner[2]);
+    }
+
+    // transposed OpenGL projection matrix like convert_matrix
+    OpenVRCullFrustum frustum;
+    frustum.offset = offset;
+    frustum.proj_mat = LMatrix4::zeros_mat();
+    frustum.proj_mat(0, 0) = 2 / (combined.right - combined.left);
+    frustum.proj_mat(2, 0) = (combined.right + combined.left) / (combined.right - combined.left);
+    frustum.proj_mat(1, 1) = 2 / (combined.top - combined.bottom);
+    frustum.proj_mat(2, 1) = (combined.top + combined.bottom) / (combined.top - combined.bottom);
+    frustum.proj_mat(2, 2) = -(cull_far + cull_near) / (cull_far - cull_near);
+    frustum.proj_mat(3, 2) = -2 * cull_far * cull_near / (cull_far - cull_near);
+    frustum.proj_mat(2, 3) = -1;
+
+    return frustum;
+}
+
+}
@@ -0,0 +1,106 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "openvr_event_dispatcher.hpp"
+
+#include <algorithm>
+
+namespace rpplugins {
+
+size_t OpenVREventDispatcher::add_handler(uint32_t event_type, const VREventHandler& handler)
+{
+    HandlerEntry entry{ next_handler_id_++, handler };
+    const size_t id = entry.id;
+
+    if (dispatching_)
+        pending_added_handlers_.emplace_back(event_type, std::move(entry));
+    else
+        handlers_[event_type].push_back(std::move(entry));
+
+    return id;
+}
+
+void OpenVREventDispatcher::remove_handler(uint32_t event_type, size_t handler_id)
+{
+    if (dispatching_)
+    {
+        // the owner of handler may be destroyed, so do not call it even for current event.
+        auto found = handlers_.find(event_type);
+        if (found != handlers_.end())
+        {
+            for (auto& entry : found->second)
+            {
+                if (entry.id == handler_id)
+                    entry.removed = true;
+            }
+        }
+
+        pending_added_handlers_.erase(std::remove_if(pending_added_handlers_.begin(), pending_added_handlers_.end(),
+            [handler_id](const std::pair<uint32_t, HandlerEntry>& type_entry) {
+                return type_entry.second.id == handler_id;
+            }), pending_added_handlers_.end());
+
+        pending_removed_handlers_.emplace_back(event_type, handler_id);
+        return;
+    }
+
+    auto found = handlers_.find(event_type);
+    if (found == handlers_.end())
+        return;
+
+    auto& handlers = found->second;
+    handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [handler_id](const HandlerEntry& entry) {
+        return entry.id == handler_id;
+    }), handlers.end());
+}
+
+void OpenVREventDispatcher::dispatch(const vr::VREvent_t& vr_event)
+{
+    auto found = handlers_.find(vr_event.eventType);
+    if (found == handlers_.end())
+        return;
+
+    dispatching_ = true;
+    for (const auto& entry : found->second)
+    {
+        if (!entry.removed)
+            entry.handler(vr_event);
+    }
+    dispatching_ = false;
+
+    apply_pending_handlers();
+}
+
+void OpenVREventDispatcher::apply_pending_handlers()
+{
+    for (auto& type_entry : pending_added_handlers_)
+        handlers_[type_entry.first].push_back(std::move(type_entry.second));
+    pending_added_handlers_.clear();
+
+    for (const auto& type_id : pending_removed_handlers_)
+        remove_handler(type_id.first, type_id.second);
+    pending_removed_handlers_.clear();
+}
+
+}
@@ -0,0 +1,98 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openvr.h>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+namespace rpplugins {
+
+/**
+ * Dispatcher of OpenVR events to handlers.
+ *
+ * Handlers can be added or removed in handlers, and the changes are applied after dispatching the event.
+ * A handler removed during dispatching is not called anymore even for current event.
+ */
+class OpenVREventDispatcher
+{
+public:
+    using VREventHandler = OpenVRPlugin::VREventHandler;
+
+    size_t add_handler(uint32_t event_type, const VREventHandler& handler);
+    void remove_handler(uint32_t event_type, size_t handler_id);
+
+    /** Call handlers of the event type. */
+    void dispatch(const vr::VREvent_t& vr_event);
+
+    /**
+     * Poll all events, append them to @p vr_events and dispatch them.
+     *
+     * @p on_event is called with each event after dispatching.
+     * @p vr_system is template to run with other implementation of PollNextEvent (ex, benchmark).
+     */
+    template <class VRSystem, class Callback>
+    void process_events(VRSystem& vr_system, std::vector<vr::VREvent_t>& vr_events, Callback&& on_event);
+
+private:
+    struct HandlerEntry
+    {
+        size_t id;
+        VREventHandler handler;
+        bool removed = false;       ///< removed during dispatching and not called anymore.
+    };
+
+    void apply_pending_handlers();
+
+    std::unordered_map<uint32_t, std::vector<HandlerEntry>> handlers_;
+    size_t next_handler_id_ = 0;
+
+    // handlers cannot be changed while dispatching, so the changes are applied after that.
+    bool dispatching_ = false;
+    std::vector<std::pair<uint32_t, HandlerEntry>> pending_added_handlers_;
+    std::vector<std::pair<uint32_t, size_t>> pending_removed_handlers_;
+};
+
+// ************************************************************************************************
+
+template <class VRSystem, class Callback>
+void OpenVREventDispatcher::process_events(VRSystem& vr_system, std::vector<vr::VREvent_t>& vr_events, Callback&& on_event)
+{
+    vr_events.clear();
+
+    vr::VREvent_t vr_event;
+    while (vr_system.PollNextEvent(&vr_event, sizeof(vr_event)))
+    {
+        vr_events.push_back(vr_event);
+        dispatch(vr_event);
+        on_event(vr_event);
+    }
+}
+
+}
@@ -0,0 +1,389 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nodePath.h>
+
+#include <boost/optional.hpp>
+
+#include <openvr.h>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+#include "openvr_event_dispatcher.hpp"
+#include "openvr_pose_conversion.hpp"
+
+namespace rpplugins {
+
+/**
+ * Per-frame update of OpenVR plugin without rendering.
+ *
+ * This processes OpenVR events, updates device nodes from poses and caches tracked device properties.
+ * @p VRSystem is template to run with other implementation of vr::IVRSystem (ex, benchmark),
+ * and only the functions used by the called members are required.
+ */
+template <class VRSystem>
+class OpenVRFrameUpdater
+{
+public:
+    using DeviceUpdateStats = OpenVRPlugin::DeviceUpdateStats;
+
+    struct CachedProperty
+    {
+        union
+        {
+            bool bool_value;
+            int32_t int32_value;
+            uint64_t uint64_value;
+            float float_value;
+            vr::HmdMatrix34_t matrix_value;
+        };
+        std::string string_value;           ///< short strings are stored without allocation.
+        vr::PropertyTypeTag_t type_tag = vr::k_unInvalidPropertyTag;     ///< type of the stored value.
+    };
+
+public:
+    OpenVRFrameUpdater();
+    OpenVRFrameUpdater(const OpenVRFrameUpdater&) = delete;
+    OpenVRFrameUpdater& operator=(const OpenVRFrameUpdater&) = delete;
+
+    /**
+     * Poll and dispatch the events of this frame.
+     *
+     * @p on_event is called with each event after dispatching.
+     */
+    template <class Callback>
+    void process_events(Callback&& on_event);
+
+    /**
+     * Convert HMD pose and update device nodes whose poses are changed.
+     *
+     * The matrix of HMD is converted for the camera although it is not changed.
+     * If @p update_device_nodes is false, only HMD pose is converted.
+     */
+    void update_poses(const vr::TrackedDevicePose_t* poses, bool update_device_nodes);
+
+    bool is_device_pose_changed(vr::TrackedDeviceIndex_t device_index, const vr::HmdMatrix34_t& pose) const;
+
+    /**
+     * Get the property of tracked device from cache or runtime.
+     *
+     * @param[out]  err     Error of runtime if it fails.
+     */
+    ///@{
+    bool get_property(bool& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const;
+    bool get_property(int32_t& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const;
+    bool get_property(uint64_t& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const;
+    bool get_property(float& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const;
+    bool get_property(vr::HmdMatrix34_t& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const;
+    ///@}
+
+    /**
+     * Get the string property without copying the string.
+     *
+     * The reference points to the cache, so it is valid until the cache of the property is cleared.
+     */
+    boost::optional<const std::string&> get_string_property(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const;
+
+    const CachedProperty* find_cached_property(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::PropertyTypeTag_t type_tag) const;
+    CachedProperty* cache_property(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::PropertyTypeTag_t type_tag) const;
+
+private:
+    template <class T, class Getter>
+    bool get_value_property(T& result, T CachedProperty::*member, vr::PropertyTypeTag_t type_tag,
+        vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err, Getter&& getter) const;
+
+public:
+    VRSystem* vr_system_ = nullptr;
+
+    float device_position_epsilon_ = 0;
+    float device_orientation_epsilon_ = 0;
+
+    std::array<NodePath, vr::k_unMaxTrackedDeviceCount> device_nodes_;
+    std::array<vr::HmdMatrix34_t, vr::k_unMaxTrackedDeviceCount> applied_device_poses_;
+    std::array<LMatrix4, vr::k_unMaxTrackedDeviceCount> device_mats_;
+    std::array<bool, vr::k_unMaxTrackedDeviceCount> device_pose_applied_ = {};
+    std::array<bool, vr::k_unMaxTrackedDeviceCount> device_node_updated_ = {};     ///< set_mat is called in current frame.
+    DeviceUpdateStats device_update_stats_;
+
+    OpenVREventDispatcher event_dispatcher_;
+    std::vector<vr::VREvent_t> vr_events_;
+
+    // cache of tracked device properties. It is invalidated by OpenVR events.
+    mutable std::array<std::unordered_map<vr::TrackedDeviceProperty, CachedProperty>, vr::k_unMaxTrackedDeviceCount> property_cache_;
+};
+
+// ************************************************************************************************
+
+template <class VRSystem>
+OpenVRFrameUpdater<VRSystem>::OpenVRFrameUpdater()
+{
+    // avoid reallocation in most frames.
+    vr_events_.reserve(64);
+
+    event_dispatcher_.add_handler(vr::VREvent_TrackedDeviceDeactivated, [this](const vr::VREvent_t& vr_ev) {
+        if (vr_ev.trackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount)
+            return;
+        property_cache_[vr_ev.trackedDeviceIndex].clear();
+        device_nodes_[vr_ev.trackedDeviceIndex].remove_node();
+        device_pose_applied_[vr_ev.trackedDeviceIndex] = false;
+    });
+
+    event_dispatcher_.add_handler(vr::VREvent_PropertyChanged, [this](const vr::VREvent_t& vr_ev) {
+        if (vr_ev.trackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount)
+            return;
+
+        // invalidate instead of erasing, so that the entry and the string buffer are reused.
+        auto& cache = property_cache_[vr_ev.trackedDeviceIndex];
+        const auto found = cache.find(vr_ev.data.property.prop);
+        if (found != cache.end())
+            found->second.type_tag = vr::k_unInvalidPropertyTag;
+    });
+}
+
+template <class VRSystem>
+template <class Callback>
+void OpenVRFrameUpdater<VRSystem>::process_events(Callback&& on_event)
+{
+    event_dispatcher_.process_events(*vr_system_, vr_events_, std::forward<Callback>(on_event));
+}
+
+template <class VRSystem>
+void OpenVRFrameUpdater<VRSystem>::update_poses(const vr::TrackedDevicePose_t* poses, bool update_device_nodes)
+{
+    // converted once for both the camera and the device node of HMD.
+    const auto& hmd_pose = poses[vr::k_unTrackedDeviceIndex_Hmd];
+    if (hmd_pose.bPoseIsValid)
+        fast_convert_pose_matrix(hmd_pose.mDeviceToAbsoluteTracking, device_mats_[vr::k_unTrackedDeviceIndex_Hmd]);
+
+    device_node_updated_.fill(false);
+    if (!update_device_nodes)
+        return;
+
+    // Skip stationary devices, because set_mat invalidates transform and bounds of the nodes.
+    device_update_stats_.updated_count = 0;
+    device_update_stats_.skipped_count = 0;
+
+    for (vr::TrackedDeviceIndex_t device_index = vr::k_unTrackedDeviceIndex_Hmd; device_index < vr::k_unMaxTrackedDeviceCount; ++device_index)
+    {
+        const auto& pose = poses[device_index];
+        if (!pose.bPoseIsValid || device_nodes_[device_index].is_empty())
+            continue;
+
+        if (!is_device_pose_changed(device_index, pose.mDeviceToAbsoluteTracking))
+        {
+            ++device_update_stats_.skipped_count;
+            continue;
+        }
+
+        applied_device_poses_[device_index] = pose.mDeviceToAbsoluteTracking;
+        device_pose_applied_[device_index] = true;
+        ++device_update_stats_.updated_count;
+
+        // convert only the changed poses.
+        // device nodes are scaled by the group node, so distance scale is not applied.
+        if (device_index != vr::k_unTrackedDeviceIndex_Hmd)
+            fast_convert_pose_matrix(pose.mDeviceToAbsoluteTracking, device_mats_[device_index]);
+
+        device_nodes_[device_index].set_mat(device_mats_[device_index]);
+        device_node_updated_[device_index] = true;
+    }
+
+    device_update_stats_.total_updated_count += device_update_stats_.updated_count;
+    device_update_stats_.total_skipped_count += device_update_stats_.skipped_count;
+}
+
+template <class VRSystem>
+bool OpenVRFrameUpdater<VRSystem>::is_device_pose_changed(vr::TrackedDeviceIndex_t device_index, const vr::HmdMatrix34_t& pose) const
+{
+    if (!device_pose_applied_[device_index])
+        return true;
+
+    const auto& prev = applied_device_poses_[device_index].m;
+    const auto& curr = pose.m;
+
+    const float dx = curr[0][3] - prev[0][3];
+    const float dy = curr[1][3] - prev[1][3];
+    const float dz = curr[2][3] - prev[2][3];
+    if (dx * dx + dy * dy + dz * dz > device_position_epsilon_ * device_position_epsilon_)
+        return true;
+
+    // difference of rotation elements is approximately radian for small angle.
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            if (std::abs(curr[r][c] - prev[r][c]) > device_orientation_epsilon_)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+template <class VRSystem>
+bool OpenVRFrameUpdater<VRSystem>::get_property(bool& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const
+{
+    return get_value_property(result, &CachedProperty::bool_value, vr::k_unBoolPropertyTag, device_index, prop, err,
+        [this](auto... args) { return vr_system_->GetBoolTrackedDeviceProperty(args...); });
+}
+
+template <class VRSystem>
+bool OpenVRFrameUpdater<VRSystem>::get_property(int32_t& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const
+{
+    return get_value_property(result, &CachedProperty::int32_value, vr::k_unInt32PropertyTag, device_index, prop, err,
+        [this](auto... args) { return vr_system_->GetInt32TrackedDeviceProperty(args...); });
+}
+
+template <class VRSystem>
+bool OpenVRFrameUpdater<VRSystem>::get_property(uint64_t& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const
+{
+    return get_value_property(result, &CachedProperty::uint64_value, vr::k_unUint64PropertyTag, device_index, prop, err,
+        [this](auto... args) { return vr_system_->GetUint64TrackedDeviceProperty(args...); });
+}
+
+template <class VRSystem>
+bool OpenVRFrameUpdater<VRSystem>::get_property(float& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const
+{
+    return get_value_property(result, &CachedProperty::float_value, vr::k_unFloatPropertyTag, device_index, prop, err,
+        [this](auto... args) { return vr_system_->GetFloatTrackedDeviceProperty(args...); });
+}
+
+template <class VRSystem>
+bool OpenVRFrameUpdater<VRSystem>::get_property(vr::HmdMatrix34_t& result, vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const
+{
+    return get_value_property(result, &CachedProperty::matrix_value, vr::k_unHmdMatrix34PropertyTag, device_index, prop, err,
+        [this](auto... args) { return vr_system_->GetMatrix34TrackedDeviceProperty(args...); });
+}
+
+template <class VRSystem>
+boost::optional<const std::string&> OpenVRFrameUpdater<VRSystem>::get_string_property(
+    vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err) const
+{
+    err = vr::TrackedProp_Success;
+    if (const auto cache = find_cached_property(device_index, prop, vr::k_unStringPropertyTag))
+        return cache->string_value;
+
+    const auto cache = cache_property(device_index, prop, vr::k_unStringPropertyTag);
+    if (!cache)
+    {
+        err = vr::TrackedProp_InvalidDevice;
+        return boost::none;
+    }
+
+    // the string is read into the cache directly.
+    std::string& result = cache->string_value;
+
+    // most properties fit in the buffer on stack, so the runtime is called once.
+    char buffer[256];
+    const uint32_t required_buffer_length = vr_system_->GetStringTrackedDeviceProperty(device_index, prop, buffer, sizeof(buffer), &err);
+    if (required_buffer_length == 0)
+    {
+        // not cached, because the property may not be ready.
+        err = vr::TrackedProp_Success;
+        cache->type_tag = vr::k_unInvalidPropertyTag;
+        result.clear();
+        return result;
+    }
+
+    if (err == vr::TrackedProp_BufferTooSmall)
+    {
+        // the length includes null terminator.
+        result.resize(required_buffer_length - 1);
+        vr_system_->GetStringTrackedDeviceProperty(device_index, prop, &result[0], required_buffer_length, &err);
+    }
+    else if (err == vr::TrackedProp_Success)
+    {
+        result.assign(buffer, required_buffer_length - 1);
+    }
+
+    if (err != vr::TrackedProp_Success)
+    {
+        cache->type_tag = vr::k_unInvalidPropertyTag;
+        return boost::none;
+    }
+
+    return result;
+}
+
+template <class VRSystem>
+auto OpenVRFrameUpdater<VRSystem>::find_cached_property(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::PropertyTypeTag_t type_tag) const -> const CachedProperty*
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount)
+        return nullptr;
+
+    const auto& cache = property_cache_[device_index];
+    const auto found = cache.find(prop);
+    if (found == cache.end())
+        return nullptr;
+
+    // the property is requested as other type or invalidated, so the runtime should be called.
+    if (found->second.type_tag != type_tag)
+        return nullptr;
+
+    return &found->second;
+}
+
+template <class VRSystem>
+auto OpenVRFrameUpdater<VRSystem>::cache_property(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::PropertyTypeTag_t type_tag) const -> CachedProperty*
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount)
+        return nullptr;
+
+    auto& cache = property_cache_[device_index][prop];
+    cache.type_tag = type_tag;
+    return &cache;
+}
+
+template <class VRSystem>
+template <class T, class Getter>
+bool OpenVRFrameUpdater<VRSystem>::get_value_property(T& result, T CachedProperty::*member, vr::PropertyTypeTag_t type_tag,
+    vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty prop, vr::ETrackedPropertyError& err, Getter&& getter) const
+{
+    err = vr::TrackedProp_Success;
+    if (const auto cache = find_cached_property(device_index, prop, type_tag))
+    {
+        result = cache->*member;
+        return true;
+    }
+
+    const T value = getter(device_index, prop, &err);
+    if (err != vr::TrackedProp_Success)
+        return false;
+
+    result = value;
+    if (auto cache = cache_property(device_index, prop, type_tag))
+        cache->*member = value;
+    return true;
+}
+
+}
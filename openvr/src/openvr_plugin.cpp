@@ -24,20 +24,33 @@
 
 #include "rpplugins/openvr/plugin.hpp"
 
-#include <thread>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 
 #include <boost/dll/alias.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include <fmt/ostream.h>
 
-#include <geomTriangles.h>
-#include <geomNode.h>
 #include <matrixLens.h>
 #include <camera.h>
-#include <materialAttrib.h>
-#include <textureAttrib.h>
+#include <buttonThrower.h>
+#include <pStatCollector.h>
+#include <pStatTimer.h>
+#include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomLinestrips.h>
 #include <geomVertexWriter.h>
+#include <omniBoundingVolume.h>
+#include <colorWriteAttrib.h>
+#include <depthTestAttrib.h>
+#include <pnmImage.h>
 
 #include <render_pipeline/rppanda/showbase/showbase.hpp>
 #include <render_pipeline/rppanda/showbase/messenger.hpp>
@@ -45,18 +58,29 @@
 #include <render_pipeline/rpcore/pluginbase/base_plugin.hpp>
 #include <render_pipeline/rpcore/pluginbase/setting_types.hpp>
 #include <render_pipeline/rpcore/globals.hpp>
-#include <render_pipeline/rpcore/util/rpmaterial.hpp>
+#include <render_pipeline/rpcore/loader.hpp>
 #include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/light_manager.hpp>
+#include <render_pipeline/rpcore/stage_manager.hpp>
 
 #include "rpplugins/openvr/controller.hpp"
 #include "rpplugins/openvr/camera_interface.hpp"
 
+#include "openvr_cull_frustum.hpp"
+#include "openvr_frame_updater.hpp"
 #include "openvr_render_stage.hpp"
+#include "openvr_pose_conversion.hpp"
+#include "openvr_pose_sampler.hpp"
+#include "openvr_render_model_loader.hpp"
 
 RENDER_PIPELINE_PLUGIN_CREATOR(rpplugins::OpenVRPlugin)
 
 namespace rpplugins {
 
+static PStatCollector openvr_wait_get_poses_pcollector("App:OpenVR:WaitGetPoses");
+static PStatCollector openvr_update_poses_pcollector("App:OpenVR:UpdatePoses");
+static PStatCollector openvr_process_events_pcollector("App:OpenVR:ProcessEvents");
+
 class OpenVRPlugin::Impl
 {
 public:
@@ -64,34 +88,88 @@ public:
     void setup_setting_changed_callback(OpenVRPlugin& self);
 
     void setup_camera(const OpenVRPlugin& self);
+    void update_cull_projection(const OpenVRPlugin& self);
     void setup_supersampling(OpenVRPlugin& self);
 
     bool init_compositor(const OpenVRPlugin& self) const;
     void create_device_node_group();
+    void setup_hidden_area_gbuffer_mask(const OpenVRPlugin& self);
+    void update_play_area();
+    void build_play_area_geom();
+    void update_play_area_node();
     void setup_device_nodes(const OpenVRPlugin& self);
     NodePath setup_device_node(const OpenVRPlugin& self, vr::TrackedDeviceIndex_t unTrackedDeviceIndex);
     NodePath setup_render_model(const OpenVRPlugin& self, vr::TrackedDeviceIndex_t unTrackedDeviceIndex);
-    NodePath load_model(const OpenVRPlugin& self, const std::string& model_name);
-    NodePath create_mesh(const std::string& model_name, vr::RenderModel_t* render_model, vr::RenderModel_TextureMap_t* render_texture);
+    NodePath load_model(const std::string& model_name);
+    NodePath load_model_async(const std::string& model_name);
+    void process_pending_render_models(const OpenVRPlugin& self);
+    void update_render_model_instances(OpenVRPlugin& self);
+    void rebuild_render_model_instances(OpenVRPlugin& self);
+    void process_screenshot_requests(const OpenVRPlugin& self);
+    void collect_screenshot_writers(const OpenVRPlugin& self, bool wait);
+
+    /** Write screenshot images in worker thread. Returns error messages. */
+    static std::vector<std::string> write_screenshots(Texture* left, Texture* right,
+        const Filename& preview_file_path, const Filename& vr_file_path);
 
     void process_vr_events(OpenVRPlugin& self);
     void wait_get_poses();
+    void update_frame_timing();
+    void update_dynamic_resolution(OpenVRPlugin& self);
+    void stop_pose_sampler();
+    void apply_render_scale(OpenVRPlugin& self, float scale);
+    void get_frame_timings(std::vector<FrameTiming>& timings) const;
+    void update_eye_poses(const NodePath& cam);
+    void set_camera_pose(const vr::HmdMatrix34_t& hmd_pose);
+    void set_camera_mat(const LMatrix4& hmd_mat);
+    void late_latch_camera_pose();
 
     std::string get_screenshot_error_message(vr::EVRScreenshotError err) const;
 
 public:
     static RequrieType require_plugins_;
 
+    // parameters of dynamic resolution
+    static constexpr float DYNAMIC_RESOLUTION_SCALE_STEP = 0.05f;
+    static constexpr float DYNAMIC_RESOLUTION_UPPER_RATIO = 0.9f;     ///< decrease resolution if GPU time is over this ratio of budget.
+    static constexpr float DYNAMIC_RESOLUTION_LOWER_RATIO = 0.7f;     ///< increase resolution if GPU time is under this ratio of budget.
+    static constexpr int DYNAMIC_RESOLUTION_DECREASE_FRAMES = 5;
+    static constexpr int DYNAMIC_RESOLUTION_INCREASE_FRAMES = 90;
+    static constexpr int DYNAMIC_RESOLUTION_COOLDOWN_FRAMES = 30;
+
     float distance_scale_ = 1.0f;
     bool update_camera_pose_ = true;
     bool update_eye_pose_ = true;
     bool create_device_node_ = false;
     bool load_render_model_ = false;
     bool enable_rendering_ = true;
+    bool send_vr_event_messages_ = true;
     SupersampleMode supersample_mode_;
 
+    bool dynamic_resolution_ = false;
+    float dynamic_resolution_scale_min_ = 1.0f;
+    float dynamic_resolution_scale_max_ = 1.0f;
+    float render_scale_ = 1.0f;
+    float frame_budget_ms_ = 1000.0f / 90.0f;
+    float seconds_from_vsync_to_photons_ = 0;
+
+    bool late_latch_ = false;
+    uint64_t photons_vsync_counter_ = 0;
+    bool photons_vsync_counter_valid_ = false;
+    vr::HmdMatrix34_t hmd_render_pose_ = {};    ///< HMD pose used for rendering in current frame.
+    bool hmd_render_pose_valid_ = false;
+    LVecBase2i base_render_size_ = LVecBase2i(0);
+    uint64_t dynamic_resolution_timing_count_ = 0;
+    int over_budget_frames_ = 0;
+    int under_budget_frames_ = 0;
+    int dynamic_resolution_cooldown_ = 0;
+
     PT(Lens) original_lens_;
+    PT(MatrixLens) vr_lens_;
+    LMatrix4 left_proj_mat_;        ///< OpenGL projection matrix of left eye.
+    LMatrix4 right_proj_mat_;       ///< OpenGL projection matrix of right eye.
     PT(rppanda::FunctionalTask) update_task_;
+    PT(rppanda::FunctionalTask) late_latch_task_;
 
     // vive data
     vr::IVRSystem* vr_system_ = nullptr;
@@ -99,12 +177,72 @@ public:
     vr::TrackedDevicePose_t tracked_device_pose_[vr::k_unMaxTrackedDeviceCount];
 
     NodePath device_node_group_;
-    std::array<NodePath, vr::k_unMaxTrackedDeviceCount> device_nodes_;
+    PT(OpenVRController) controller_;
     NodePath controller_node_;
 
+    NodePath hidden_area_gbuffer_mask_np_;
+
+    // play area of chaperone is cached until chaperone events.
+    bool play_area_dirty_ = true;
+    boost::optional<LVecBase2> play_area_size_;
+    boost::optional<std::array<LPoint3, 4>> play_area_rect_;    ///< corners in Z-up coordinates (meter).
+    NodePath play_area_np_;
+
+    NodePath left_eye_np_;
+    NodePath right_eye_np_;
+    bool eye_pose_dirty_ = true;
+
     std::unique_ptr<OpenVRCameraInterface> tracked_camera_;
 
-    std::vector<vr::VREvent_t> vr_events_;
+    struct PendingRenderModel
+    {
+        NodePath placeholder;
+        std::shared_future<OpenVRRenderModelLoader::RenderModel> future;
+    };
+    std::unique_ptr<OpenVRRenderModelLoader> render_model_loader_;
+    std::vector<PendingRenderModel> pending_render_models_;
+
+    // render models of devices and the models drawn by instancing.
+    struct RenderModelInstances
+    {
+        NodePath np;
+        PT(Texture) transforms;             ///< buffer texture of local matrices of device nodes.
+        std::vector<vr::TrackedDeviceIndex_t> devices;
+        int instance_count = 0;             ///< the number of visible devices. The node is stashed if 0.
+        std::array<bool, vr::k_unMaxTrackedDeviceCount> device_hidden = {};    ///< visibility of devices written to the buffer.
+        bool transforms_dirty = true;       ///< the buffer should be written although devices are not changed.
+    };
+    int render_model_instancing_threshold_ = 0;
+    bool render_model_instances_dirty_ = false;
+    std::array<std::string, vr::k_unMaxTrackedDeviceCount> device_render_model_names_;
+    std::array<NodePath, vr::k_unMaxTrackedDeviceCount> device_render_models_;
+    std::unordered_map<std::string, RenderModelInstances> render_model_instances_;
+    std::vector<std::pair<std::string, std::shared_future<OpenVRRenderModelLoader::RenderModel>>> loading_render_model_instances_;
+
+    struct ScreenshotRequest
+    {
+        Filename preview_file_path;
+        Filename vr_file_path;
+        std::promise<bool> promise;
+    };
+    OpenVRRenderStage* render_stage_ = nullptr;
+
+    // shared with consumer threads draining samples.
+    std::shared_ptr<OpenVRPoseSampler> pose_sampler_;
+    std::deque<ScreenshotRequest> screenshot_requests_;
+    bool screenshot_copy_triggered_ = false;
+    std::vector<std::future<std::vector<std::string>>> screenshot_writers_;   ///< results are error messages.
+
+    // single producer (update task) ring buffer of frame timings.
+    std::array<FrameTiming, FRAME_TIMING_HISTORY_SIZE> frame_timings_;
+    std::atomic<uint64_t> frame_timing_write_count_{ 0 };
+    std::atomic<uint64_t> total_frame_count_{ 0 };
+    std::atomic<uint64_t> total_dropped_frames_{ 0 };
+    std::atomic<uint64_t> total_reprojected_frames_{ 0 };
+    uint32_t last_frame_timing_index_ = 0;
+
+    // events, device nodes and property cache. This is also used in benchmark.
+    OpenVRFrameUpdater<vr::IVRSystem> frame_updater_;
 };
 
 // ************************************************************************************************
@@ -114,15 +252,39 @@ OpenVRPlugin::RequrieType OpenVRPlugin::Impl::require_plugins_;
 void OpenVRPlugin::Impl::on_stage_setup(OpenVRPlugin& self)
 {
     if (enable_rendering_)
-        self.add_stage(std::make_unique<OpenVRRenderStage>(self.pipeline_));
+    {
+        const std::string submit_mode = self.get_setting<rpcore::EnumType>("submit_mode");
+        self.debug(fmt::format("Submit mode in OpenVR plugin: {}", submit_mode));
+
+        OpenVRRenderStage::SubmitMode mode = OpenVRRenderStage::SubmitMode::separate;
+        if (submit_mode == "side_by_side")
+            mode = OpenVRRenderStage::SubmitMode::side_by_side;
+        else if (submit_mode == "texture_array")
+            mode = OpenVRRenderStage::SubmitMode::texture_array;
+
+        auto render_stage = std::make_unique<OpenVRRenderStage>(self.pipeline_, mode);
+        render_stage_ = render_stage.get();
+        self.add_stage(std::move(render_stage));
+    }
 
     setup_setting_changed_callback(self);
 
     self.setting_changed_callbacks_.at("distance_scale")();
+    self.setting_changed_callbacks_.at("send_vr_event_messages")();
     self.setting_changed_callbacks_.at("update_camera_pose")();
     self.setting_changed_callbacks_.at("update_eye_pose")();
     self.setting_changed_callbacks_.at("load_render_model")();
     self.setting_changed_callbacks_.at("create_device_node")();
+    self.setting_changed_callbacks_.at("device_position_epsilon")();
+    self.setting_changed_callbacks_.at("device_orientation_epsilon")();
+    self.setting_changed_callbacks_.at("dynamic_resolution")();
+    self.setting_changed_callbacks_.at("late_latch")();
+    self.setting_changed_callbacks_.at("render_model_instancing_threshold")();
+
+    float display_frequency = 0;
+    if (self.get_tracked_device_property(display_frequency, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float) && display_frequency > 0)
+        frame_budget_ms_ = 1000.0f / display_frequency;
+    self.get_tracked_device_property(seconds_from_vsync_to_photons_, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float);
 
     if (!init_compositor(self))
     {
@@ -132,35 +294,95 @@ void OpenVRPlugin::Impl::on_stage_setup(OpenVRPlugin& self)
 
     setup_device_nodes(self);
 
+    self.setting_changed_callbacks_.at("pose_sampling_rate")();
+
+    if (enable_rendering_)
+    {
+        setup_hidden_area_gbuffer_mask(self);
+        self.setting_changed_callbacks_.at("hidden_area_gbuffer_mask")();
+    }
+
     if (self.get_setting<rpcore::BoolType>("enable_controller"))
     {
-        PT(OpenVRController) node = new OpenVRController(vr_system_);
-        controller_node_ = rpcore::Globals::base->get_data_root().attach_new_node(node);
+        controller_ = new OpenVRController(vr_system_);
+        for (vr::TrackedDeviceIndex_t k = 0; k < vr::k_unMaxTrackedDeviceCount; ++k)
+        {
+            if (vr_system_->IsTrackedDeviceConnected(k))
+                controller_->add_device(k);
+        }
+        controller_node_ = rpcore::Globals::base->get_data_root().attach_new_node(controller_);
+
+        // throw button events of controllers to messenger
+        controller_node_.attach_new_node(new ButtonThrower("OpenVRButtonThrower"));
     }
 
     // we add wait_get_poses task with -50 sort
     // to guarentee normal cases using camera position or etc.
     update_task_ = self.add_task([&, this](rppanda::FunctionalTask*) {
         wait_get_poses();
+        update_frame_timing();
+        update_dynamic_resolution(self);
         process_vr_events(self);
+        update_play_area_node();
+        process_pending_render_models(self);
+        update_render_model_instances(self);
+        process_screenshot_requests(self);
+
         return AsyncTask::DoneStatus::DS_cont;
     }, "OpenVRPlugin::wait_get_poses", UPDATE_TASK_SORT);
 
-    self.accept("VREvent_TrackedDeviceActivated", [&, this](const Event* ev) {
-        const auto& vr_ev = vr_events_[ev->get_parameter(0).get_int_value()];
+    // re-predict the camera pose after application tasks and before pipeline and culling use it,
+    // and pass the final pose of this frame to the render stage.
+    late_latch_task_ = self.add_task([this](rppanda::FunctionalTask*) {
+        late_latch_camera_pose();
+
+        // the pose is submitted with textures only if the camera follows HMD.
+        if (render_stage_)
+            render_stage_->set_render_pose(update_camera_pose_ && hmd_render_pose_valid_ ? &hmd_render_pose_ : nullptr);
 
+        return AsyncTask::DoneStatus::DS_cont;
+    }, "OpenVRPlugin::late_latch_camera_pose", LATE_LATCH_TASK_SORT);
+
+    frame_updater_.event_dispatcher_.add_handler(vr::VREvent_TrackedDeviceActivated, [&, this](const vr::VREvent_t& vr_ev) {
         if (vr_ev.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd)
             return;
 
+        if (controller_)
+            controller_->add_device(vr_ev.trackedDeviceIndex);
+
         if (load_render_model_)
             setup_render_model(self, vr_ev.trackedDeviceIndex);
         else if (create_device_node_)
             setup_device_node(self, vr_ev.trackedDeviceIndex);
     });
 
-    self.accept("VREvent_TrackedDeviceDeactivated", [&, this](const Event* ev) {
-        const auto& vr_ev = vr_events_[ev->get_parameter(0).get_int_value()];
-        device_nodes_[vr_ev.trackedDeviceIndex].remove_node();
+    frame_updater_.event_dispatcher_.add_handler(vr::VREvent_TrackedDeviceDeactivated, [this](const vr::VREvent_t& vr_ev) {
+        if (vr_ev.trackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount)
+            return;
+        // the device node and the property cache are cleared in OpenVRFrameUpdater.
+        if (controller_)
+            controller_->remove_device(vr_ev.trackedDeviceIndex);
+
+        if (!device_render_models_[vr_ev.trackedDeviceIndex].is_empty())
+        {
+            device_render_models_[vr_ev.trackedDeviceIndex] = NodePath();
+            device_render_model_names_[vr_ev.trackedDeviceIndex].clear();
+            render_model_instances_dirty_ = true;
+        }
+    });
+
+    for (const auto event_type: { vr::VREvent_ChaperoneDataHasChanged, vr::VREvent_ChaperoneUniverseHasChanged })
+    {
+        frame_updater_.event_dispatcher_.add_handler(event_type, [this](const vr::VREvent_t&) {
+            play_area_dirty_ = true;
+            if (!play_area_np_.is_empty())
+                build_play_area_geom();
+        });
+    }
+
+    frame_updater_.event_dispatcher_.add_handler(vr::VREvent_IpdChanged, [&, this](const vr::VREvent_t&) {
+        eye_pose_dirty_ = true;
+        update_cull_projection(self);
     });
 
     self.debug("Finish to initialize OpenVR.");
@@ -170,10 +392,50 @@ void OpenVRPlugin::Impl::setup_setting_changed_callback(OpenVRPlugin& self)
 {
     self.setting_changed_callbacks_.insert({
         { "distance_scale", [&, this]() { self.set_distance_scale(self.get_setting<rpcore::FloatType>("distance_scale")); } },
+        { "send_vr_event_messages", [&, this]() { send_vr_event_messages_ = self.get_setting<rpcore::BoolType>("send_vr_event_messages"); } },
         { "update_camera_pose", [&, this]() { update_camera_pose_ = self.get_setting<rpcore::BoolType>("update_camera_pose"); } },
-        { "update_eye_pose", [&, this]() { update_eye_pose_ = self.get_setting<rpcore::BoolType>("update_eye_pose"); } },
+        { "update_eye_pose", [&, this]() {
+            update_eye_pose_ = self.get_setting<rpcore::BoolType>("update_eye_pose");
+            eye_pose_dirty_ = true;
+        } },
         { "load_render_model", [&, this]() { load_render_model_ = self.get_setting<rpcore::BoolType>("load_render_model"); } },
         { "create_device_node", [&, this]() { create_device_node_ = load_render_model_ || self.get_setting<rpcore::BoolType>("create_device_node"); } },
+        { "device_position_epsilon", [&, this]() { frame_updater_.device_position_epsilon_ = self.get_setting<rpcore::FloatType>("device_position_epsilon"); } },
+        { "device_orientation_epsilon", [&, this]() { frame_updater_.device_orientation_epsilon_ = self.get_setting<rpcore::FloatType>("device_orientation_epsilon"); } },
+        { "dynamic_resolution", [&, this]() {
+            // applied in update task
+            dynamic_resolution_ = self.get_setting<rpcore::BoolType>("dynamic_resolution");
+            dynamic_resolution_scale_min_ = self.get_setting<rpcore::FloatType>("dynamic_resolution_scale_min");
+            dynamic_resolution_scale_max_ = (std::max)(dynamic_resolution_scale_min_, self.get_setting<rpcore::FloatType>("dynamic_resolution_scale_max"));
+            if (dynamic_resolution_ && (base_render_size_[0] == 0 || base_render_size_[1] == 0))
+                self.warn("Dynamic resolution is not applied, because render target size of OpenVR is unknown.");
+        } },
+        { "late_latch", [&, this]() { late_latch_ = self.get_setting<rpcore::BoolType>("late_latch"); } },
+        { "render_model_instancing_threshold", [&, this]() {
+            render_model_instancing_threshold_ = self.get_setting<rpcore::IntType>("render_model_instancing_threshold");
+            render_model_instances_dirty_ = true;
+        } },
+        { "pose_sampling_rate", [&, this]() {
+            stop_pose_sampler();
+
+            const float rate = self.get_setting<rpcore::FloatType>("pose_sampling_rate");
+            if (rate > 0 && vr_system_ && vr::VRCompositor())
+            {
+                std::atomic_store(&pose_sampler_, std::make_shared<OpenVRPoseSampler>(
+                    vr_system_, vr::VRCompositor()->GetTrackingSpace(), rate));
+                self.debug(fmt::format("Pose sampler is started at {} Hz.", rate));
+            }
+        } },
+        { "hidden_area_gbuffer_mask", [&, this]() {
+            if (hidden_area_gbuffer_mask_np_.is_empty())
+                return;
+            if (self.get_setting<rpcore::BoolType>("hidden_area_gbuffer_mask"))
+                hidden_area_gbuffer_mask_np_.unstash();
+            else
+                hidden_area_gbuffer_mask_np_.stash();
+        } },
+        { "dynamic_resolution_scale_min", [&]() { self.setting_changed_callbacks_.at("dynamic_resolution")(); } },
+        { "dynamic_resolution_scale_max", [&]() { self.setting_changed_callbacks_.at("dynamic_resolution")(); } },
     });
 }
 
@@ -205,30 +467,49 @@ void OpenVRPlugin::Impl::setup_camera(const OpenVRPlugin& self)
         rpcore::Globals::base->get_cam_node()->set_lens(vr_lens);
     }
 
+    vr_lens_ = vr_lens;
+
     // Y-up matrix
-    LMatrix4 proj_mat;
+    LMatrix4& proj_mat = right_proj_mat_;
 
     // left
-    convert_matrix(vr_system_->GetProjectionMatrix(vr::Eye_Left, vr_lens->get_near(), vr_lens->get_far()), proj_mat);
+    convert_matrix(vr_system_->GetProjectionMatrix(vr::Eye_Left, vr_lens->get_near(), vr_lens->get_far()), left_proj_mat_);
 
     // film size will be changed in WindowFramework::adjust_dimensions when resizing.
     // so, we need to post-multiply the inverse matrix to preserve our projection matrix.
-    vr_lens->set_left_eye_mat(LMatrix4::z_to_y_up_mat() * proj_mat * vr_lens->get_film_mat_inv());
-
-    // FIXME: fix to projection matrix for stereo culling mono projection for culling
-    // mono lens (see PerspectiveLens::do_compute_projection_mat)
-    proj_mat(2, 0) = 0;
-    proj_mat(2, 1) = 0;
-    vr_lens->set_user_mat(LMatrix4::z_to_y_up_mat() * proj_mat * vr_lens->get_film_mat_inv());
+    vr_lens->set_left_eye_mat(LMatrix4::z_to_y_up_mat() * left_proj_mat_ * vr_lens->get_film_mat_inv());
 
     // right
     convert_matrix(vr_system_->GetProjectionMatrix(vr::Eye_Right, vr_lens->get_near(), vr_lens->get_far()), proj_mat);
     vr_lens->set_right_eye_mat(LMatrix4::z_to_y_up_mat() * proj_mat * vr_lens->get_film_mat_inv());
 
+    // mono projection for culling
+    update_cull_projection(self);
+
     if (std::abs(original_lens_->get_aspect_ratio() - (proj_mat[1][1] / proj_mat[0][0])) < 0.00001f)
         self.error("Aspect ratio of render target is not same as that of VR resolution.");
 }
 
+void OpenVRPlugin::Impl::update_cull_projection(const OpenVRPlugin& self)
+{
+    if (!vr_lens_)
+        return;
+
+    // eyes can be canted, and the position is scaled in camera space.
+    LMatrix4 left_eye_to_head = convert_matrix(vr_system_->GetEyeToHeadTransform(vr::Eye_Left));
+    left_eye_to_head.set_row(3, left_eye_to_head.get_row3(3) * distance_scale_);
+    LMatrix4 right_eye_to_head = convert_matrix(vr_system_->GetEyeToHeadTransform(vr::Eye_Right));
+    right_eye_to_head.set_row(3, right_eye_to_head.get_row3(3) * distance_scale_);
+
+    const OpenVRCullFrustum frustum = compute_cull_frustum(left_proj_mat_, left_eye_to_head,
+        right_proj_mat_, right_eye_to_head, vr_lens_->get_near(), vr_lens_->get_far());
+
+    vr_lens_->set_user_mat(LMatrix4::translate_mat(0, frustum.offset, 0) * LMatrix4::z_to_y_up_mat() *
+        frustum.proj_mat * vr_lens_->get_film_mat_inv());
+
+    self.debug(fmt::format("Culling frustum of OpenVR lens is moved backward by {}.", frustum.offset));
+}
+
 void OpenVRPlugin::Impl::setup_supersampling(OpenVRPlugin& self)
 {
     const std::string supersample_mode = self.get_setting<rpcore::EnumType>("supersample_mode");
@@ -241,6 +522,13 @@ void OpenVRPlugin::Impl::setup_supersampling(OpenVRPlugin& self)
     else
         supersample_mode_ = SupersampleMode::auto_mode;
 
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // dynamic resolution scales the base size, so it is set in all paths.
+    vr_system_->GetRecommendedRenderTargetSize(&width, &height);
+    base_render_size_ = LVecBase2i(width, height);
+
     auto vr_settings = vr::VRSettings();
     if (!vr_settings)
     {
@@ -264,9 +552,6 @@ void OpenVRPlugin::Impl::setup_supersampling(OpenVRPlugin& self)
     float new_supersample_scale = self.get_setting<rpcore::FloatType>("supersample_scale");
     const float supersample_scale_min = self.get_setting<rpcore::FloatType>("supersample_scale_min");
 
-    uint32_t width = 0;
-    uint32_t height = 0;
-
     switch (supersample_mode_)
     {
         case SupersampleMode::auto_mode:
@@ -287,11 +572,11 @@ void OpenVRPlugin::Impl::setup_supersampling(OpenVRPlugin& self)
                 vr_settings->SetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float,
                     (std::max)(supersample_scale_min, new_supersample_scale), &settings_error);
 
+                // the recommended size uses the scale in SteamVR if setting is failed.
                 if (settings_error != vr::EVRSettingsError::VRSettingsError_None)
                 {
                     self.error(fmt::format("Unable to set supersample scale: {}",
                         vr_settings->GetSettingsErrorNameFromEnum(settings_error)));
-                    break;
                 }
             }
 
@@ -314,6 +599,8 @@ void OpenVRPlugin::Impl::setup_supersampling(OpenVRPlugin& self)
     }
 
     self.debug(fmt::format("OpenVR render target size: ({}, {})", width, height));
+
+    base_render_size_ = LVecBase2i(width, height);
 }
 
 bool OpenVRPlugin::Impl::init_compositor(const OpenVRPlugin& self) const
@@ -336,6 +623,136 @@ void OpenVRPlugin::Impl::create_device_node_group()
     device_node_group_.set_scale(distance_scale_);
 }
 
+void OpenVRPlugin::Impl::setup_hidden_area_gbuffer_mask(const OpenVRPlugin& self)
+{
+    // vertex: NDC of hidden area mesh and eye index as z.
+    PT(GeomVertexData) vdata = new GeomVertexData("hidden_area_mesh", GeomVertexFormat::get_v3(), GeomEnums::UH_static);
+    PT(GeomTriangles) prim = new GeomTriangles(GeomEnums::UH_static);
+
+    int vertex_count = 0;
+    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+    for (const auto eye: { vr::Eye_Left, vr::Eye_Right })
+    {
+        const vr::HiddenAreaMesh_t mesh = vr_system_->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Standard);
+        if (!mesh.pVertexData || mesh.unTriangleCount == 0)
+            continue;
+
+        const int count = static_cast<int>(mesh.unTriangleCount * 3);
+        vdata->reserve_num_rows(vertex_count + count);
+
+        // (0, 0) of the mesh is top-left.
+        for (int k = 0; k < count; ++k)
+        {
+            const auto& v = mesh.pVertexData[k];
+            vertex.add_data3(v.v[0] * 2.0f - 1.0f, 1.0f - v.v[1] * 2.0f, static_cast<float>(eye));
+        }
+
+        prim->add_consecutive_vertices(vertex_count, count);
+        vertex_count += count;
+    }
+
+    if (vertex_count == 0)
+    {
+        self.debug("HMD does not have hidden area mesh.");
+        return;
+    }
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(prim);
+
+    PT(GeomNode) geom_node = new GeomNode("openvr_hidden_area_gbuffer_mask");
+    geom_node->add_geom(geom);
+
+    // vertices are already in clip space.
+    geom_node->set_bounds(new OmniBoundingVolume);
+    geom_node->set_final(true);
+
+    hidden_area_gbuffer_mask_np_ = rpcore::Globals::render.attach_new_node(geom_node);
+    hidden_area_gbuffer_mask_np_.set_shader(rpcore::RPLoader::load_shader({
+        "/$$rp/rpplugins/" RPPLUGINS_ID_STRING "/shader/hidden_area_mask.vert.glsl",
+        "/$$rp/rpplugins/" RPPLUGINS_ID_STRING "/shader/hidden_area_mask.frag.glsl",
+        "/$$rp/rpplugins/" RPPLUGINS_ID_STRING "/shader/hidden_area_mask.geom.glsl" }), 1000);
+
+    // write only the nearest depth before the scene, so GBuffer pass will skip the area.
+    hidden_area_gbuffer_mask_np_.set_attrib(ColorWriteAttrib::make(ColorWriteAttrib::C_off), 1000);
+    // note: depth is not written if depth test is disabled.
+    hidden_area_gbuffer_mask_np_.set_attrib(DepthTestAttrib::make(RenderAttrib::M_always), 1000);
+    hidden_area_gbuffer_mask_np_.set_depth_write(true, 1000);
+    hidden_area_gbuffer_mask_np_.set_two_sided(true, 1000);
+    hidden_area_gbuffer_mask_np_.set_bin("background", -100, 1000);
+
+    // render only in main camera (not shadow, voxelization, etc).
+    hidden_area_gbuffer_mask_np_.hide(BitMask32::all_on());
+    hidden_area_gbuffer_mask_np_.show(DCAST(Camera, rpcore::Globals::base->get_cam().node())->get_camera_mask());
+
+    self.debug(fmt::format("Hidden area mask is created with {} triangles.", vertex_count / 3));
+}
+
+void OpenVRPlugin::Impl::update_play_area()
+{
+    if (!play_area_dirty_)
+        return;
+
+    auto chaperone = vr::VRChaperone();
+    if (!chaperone)
+        return;
+
+    // keep dirty until chaperone is ready.
+    LVecBase2f size;
+    vr::HmdQuad_t rect;
+    if (!chaperone->GetPlayAreaSize(&size[0], &size[1]) || !chaperone->GetPlayAreaRect(&rect))
+    {
+        play_area_size_ = boost::none;
+        play_area_rect_ = boost::none;
+        return;
+    }
+
+    play_area_size_ = size;
+
+    std::array<LPoint3, 4> corners;
+    for (size_t k = 0; k < corners.size(); ++k)
+    {
+        const auto& v = rect.vCorners[k].v;
+        corners[k] = LPoint3(v[0], -v[2], v[1]);
+    }
+    play_area_rect_ = corners;
+
+    play_area_dirty_ = false;
+}
+
+void OpenVRPlugin::Impl::build_play_area_geom()
+{
+    update_play_area();
+
+    auto geom_node = DCAST(GeomNode, play_area_np_.node());
+    geom_node->remove_all_geoms();
+
+    if (!play_area_rect_)
+        return;
+
+    PT(GeomVertexData) vdata = new GeomVertexData("play_area", GeomVertexFormat::get_v3(), GeomEnums::UH_static);
+    vdata->unclean_set_num_rows(4);
+    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+    for (const auto& corner: *play_area_rect_)
+        vertex.set_data3(corner);
+
+    PT(GeomLinestrips) prim = new GeomLinestrips(GeomEnums::UH_static);
+    prim->add_consecutive_vertices(0, 4);
+    prim->add_vertex(0);
+    prim->close_primitive();
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(prim);
+    geom_node->add_geom(geom);
+}
+
+void OpenVRPlugin::Impl::update_play_area_node()
+{
+    // the node may be created before chaperone is ready, so retry until the geometry is built.
+    if (play_area_dirty_ && !play_area_np_.is_empty())
+        build_play_area_geom();
+}
+
 void OpenVRPlugin::Impl::setup_device_nodes(const OpenVRPlugin& self)
 {
     if (!vr_system_)
@@ -368,16 +785,20 @@ NodePath OpenVRPlugin::Impl::setup_device_node(const OpenVRPlugin& self, vr::Tra
 
     create_device_node_group();
 
-    if (!device_nodes_[unTrackedDeviceIndex])
+    if (!frame_updater_.device_nodes_[unTrackedDeviceIndex])
     {
-        device_nodes_[unTrackedDeviceIndex] = device_node_group_.attach_new_node("device" + std::to_string(unTrackedDeviceIndex));
+        frame_updater_.device_nodes_[unTrackedDeviceIndex] = device_node_group_.attach_new_node("device" + std::to_string(unTrackedDeviceIndex));
     }
 
-    std::string prop;
-    self.get_tracked_device_property(prop, unTrackedDeviceIndex, vr::Prop_SerialNumber_String);
-    device_nodes_[unTrackedDeviceIndex].set_tag("serial_number", prop);
+    // force to update the pose of new node.
+    frame_updater_.device_pose_applied_[unTrackedDeviceIndex] = false;
+
+    if (const auto serial_number = self.get_tracked_device_string_property(unTrackedDeviceIndex, vr::Prop_SerialNumber_String))
+        frame_updater_.device_nodes_[unTrackedDeviceIndex].set_tag("serial_number", *serial_number);
+    else
+        frame_updater_.device_nodes_[unTrackedDeviceIndex].set_tag("serial_number", "");
 
-    return device_nodes_[unTrackedDeviceIndex];
+    return frame_updater_.device_nodes_[unTrackedDeviceIndex];
 }
 
 NodePath OpenVRPlugin::Impl::setup_render_model(const OpenVRPlugin& self, vr::TrackedDeviceIndex_t unTrackedDeviceIndex)
@@ -386,221 +807,597 @@ NodePath OpenVRPlugin::Impl::setup_render_model(const OpenVRPlugin& self, vr::Tr
         return NodePath();
 
     setup_device_node(self, unTrackedDeviceIndex);
-    if (!device_nodes_[unTrackedDeviceIndex])
+    if (!frame_updater_.device_nodes_[unTrackedDeviceIndex])
         return NodePath();
 
-    // try to find a model we've already set up
-    NodePath model = self.load_model(unTrackedDeviceIndex);
+    const auto model_name = self.get_tracked_device_string_property(unTrackedDeviceIndex, vr::Prop_RenderModelName_String);
+
+    // model will be attached to the placeholder when loading is finished.
+    NodePath model = model_name ? load_model_async(*model_name) : NodePath();
     if (model)
     {
-        model.reparent_to(device_nodes_[unTrackedDeviceIndex]);
+        model.reparent_to(frame_updater_.device_nodes_[unTrackedDeviceIndex]);
+
+        if (!device_render_models_[unTrackedDeviceIndex].is_empty() && device_render_models_[unTrackedDeviceIndex] != model)
+            device_render_models_[unTrackedDeviceIndex].remove_node();
+        device_render_models_[unTrackedDeviceIndex] = model;
+        device_render_model_names_[unTrackedDeviceIndex] = model_name;
+        render_model_instances_dirty_ = true;
     }
     else
     {
         self.error(fmt::format("Unable to load render model for tracked device {} ({})",
-            unTrackedDeviceIndex, device_nodes_[unTrackedDeviceIndex].get_name()));
+            unTrackedDeviceIndex, frame_updater_.device_nodes_[unTrackedDeviceIndex].get_name()));
     }
 
     return model;
 }
 
-NodePath OpenVRPlugin::Impl::load_model(const OpenVRPlugin& self, const std::string& model_name)
+NodePath OpenVRPlugin::Impl::load_model(const std::string& model_name)
+{
+    if (!render_model_loader_)
+        return NodePath();
+
+    const auto& model = render_model_loader_->request(model_name).get();
+    if (!model.geom)
+        return NodePath();
+
+    return OpenVRRenderModelLoader::make_node(model_name, model);
+}
+
+NodePath OpenVRPlugin::Impl::load_model_async(const std::string& model_name)
+{
+    if (!render_model_loader_)
+        return NodePath();
+
+    NodePath placeholder(model_name);
+    pending_render_models_.push_back({ placeholder, render_model_loader_->request(model_name) });
+    return placeholder;
+}
+
+void OpenVRPlugin::Impl::process_pending_render_models(const OpenVRPlugin& self)
 {
-    vr::RenderModel_t* model = nullptr;
-    vr::EVRRenderModelError model_error;
-    while (1)
+    for (auto iter = pending_render_models_.begin(); iter != pending_render_models_.end();)
     {
-        model_error = vr::VRRenderModels()->LoadRenderModel_Async(model_name.c_str(), &model);
-        if (model_error != vr::VRRenderModelError_Loading)
-            break;
+        if (iter->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++iter;
+            continue;
+        }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const auto& model = iter->future.get();
+        if (model.geom)
+            OpenVRRenderModelLoader::make_node(iter->placeholder.get_name(), model).reparent_to(iter->placeholder);
+        else
+            self.error(fmt::format("Unable to load render model ({})", iter->placeholder.get_name()));
+
+        iter = pending_render_models_.erase(iter);
     }
+}
 
-    if (!model || model_error != vr::VRRenderModelError_None)
+void OpenVRPlugin::Impl::update_render_model_instances(OpenVRPlugin& self)
+{
+    // check only the models in loading, and rebuild after one of them is loaded.
+    if (!render_model_instances_dirty_)
     {
-        self.error(fmt::format("Unable to load render model {} - {}", model_name, vr::VRRenderModels()->GetRenderModelErrorNameFromEnum(model_error)));
-        return NodePath();
+        render_model_instances_dirty_ = std::any_of(loading_render_model_instances_.begin(), loading_render_model_instances_.end(),
+            [](const std::pair<std::string, std::shared_future<OpenVRRenderModelLoader::RenderModel>>& name_future) {
+                return name_future.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            });
     }
 
-    vr::RenderModel_TextureMap_t* texture;
-    while (1)
+    if (render_model_instances_dirty_)
     {
-        model_error = vr::VRRenderModels()->LoadTexture_Async(model->diffuseTextureId, &texture);
-        if (model_error != vr::VRRenderModelError_Loading)
-            break;
+        render_model_instances_dirty_ = false;
+        rebuild_render_model_instances(self);
+    }
+
+    // the local matrices of device nodes are already updated from poses.
+    for (auto& name_instances: render_model_instances_)
+    {
+        auto& instances = name_instances.second;
+
+        // modifying RAM image uploads the buffer again,
+        // so it is written only if a device node is moved or its visibility is changed.
+        bool changed = instances.transforms_dirty;
+        for (const auto device_index: instances.devices)
+        {
+            const bool hidden = frame_updater_.device_nodes_[device_index].is_hidden();
+            changed = changed || frame_updater_.device_node_updated_[device_index] || hidden != instances.device_hidden[device_index];
+            instances.device_hidden[device_index] = hidden;
+        }
+
+        if (!changed)
+            continue;
+        instances.transforms_dirty = false;
+
+        PTA_uchar ram_image = instances.transforms->modify_ram_image();
+        float* data = reinterpret_cast<float*>(ram_image.p());
+        int instance_count = 0;
+        for (const auto device_index: instances.devices)
+        {
+            // hidden devices are not drawn like the models under the device nodes.
+            if (instances.device_hidden[device_index])
+                continue;
+
+            const LMatrix4& mat = frame_updater_.device_nodes_[device_index].get_mat();
+            for (int r = 0; r < 4; ++r)
+            {
+                for (int c = 0; c < 4; ++c)
+                    *data++ = static_cast<float>(mat(r, c));
+            }
+            ++instance_count;
+        }
+
+        if (instance_count == instances.instance_count)
+            continue;
+
+        // instance count 0 disables instancing, so stash the node instead.
+        if (instance_count == 0)
+        {
+            instances.np.stash();
+        }
+        else
+        {
+            if (instances.instance_count == 0)
+                instances.np.unstash();
+            instances.np.set_instance_count(instance_count);
+        }
+        instances.instance_count = instance_count;
+    }
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+void OpenVRPlugin::Impl::rebuild_render_model_instances(OpenVRPlugin& self)
+{
+    loading_render_model_instances_.clear();
+
+    std::unordered_map<std::string, std::vector<vr::TrackedDeviceIndex_t>> devices_by_model;
+    for (vr::TrackedDeviceIndex_t k = 0; k < vr::k_unMaxTrackedDeviceCount; ++k)
+    {
+        if (!device_render_models_[k].is_empty())
+            devices_by_model[device_render_model_names_[k]].push_back(k);
     }
 
-    if (model_error != vr::VRRenderModelError_None)
+    const auto use_instancing = [this](size_t device_count) {
+        return render_model_instancing_threshold_ > 0 && device_count >= static_cast<size_t>(render_model_instancing_threshold_);
+    };
+
+    for (auto iter = render_model_instances_.begin(); iter != render_model_instances_.end();)
     {
-        self.error(fmt::format("Unable to load render texture for render model {}", model_name));
-        vr::VRRenderModels()->FreeRenderModel(model);
-        return NodePath();
+        const auto found = devices_by_model.find(iter->first);
+        if (found == devices_by_model.end() || !use_instancing(found->second.size()))
+        {
+            iter->second.np.remove_node();
+            iter = render_model_instances_.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
     }
 
-    NodePath model_np = create_mesh(model_name, model, texture);
+    for (const auto& name_devices: devices_by_model)
+    {
+        const std::string& model_name = name_devices.first;
+        const auto& devices = name_devices.second;
+
+        bool instanced = false;
+        if (use_instancing(devices.size()) && render_model_loader_)
+        {
+            auto found = render_model_instances_.find(model_name);
+            if (found == render_model_instances_.end())
+            {
+                // Geom and Texture are shared with the models of each device.
+                auto future = render_model_loader_->request(model_name);
+                const bool loaded = future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                if (loaded && future.get().geom)
+                {
+                    RenderModelInstances instances;
+                    instances.transforms = new Texture("openvr_render_model_instances");
+                    instances.transforms->setup_buffer_texture(vr::k_unMaxTrackedDeviceCount * 4,
+                        Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+
+                    instances.np = OpenVRRenderModelLoader::make_node(model_name, future.get());
+                    instances.np.reparent_to(device_node_group_);
+                    instances.np.set_shader_input("InstancingData", instances.transforms);
+
+                    // instances are spread in the tracking space.
+                    instances.np.node()->set_bounds(new OmniBoundingVolume);
+                    instances.np.node()->set_final(true);
+
+                    self.pipeline_.set_effect(instances.np,
+                        "/$$rp/rpplugins/" RPPLUGINS_ID_STRING "/shader/render_model_instancing.yaml", {});
+
+                    // stashed until visible devices are counted in update.
+                    instances.np.stash();
 
-    vr::VRRenderModels()->FreeRenderModel(model);
-    vr::VRRenderModels()->FreeTexture(texture);
+                    self.debug(fmt::format("Render model ({}) is drawn by instancing.", model_name));
 
-    return model_np;
+                    found = render_model_instances_.emplace(model_name, std::move(instances)).first;
+                }
+                else if (!loaded)
+                {
+                    // retry after loading.
+                    loading_render_model_instances_.emplace_back(model_name, std::move(future));
+                }
+            }
+
+            if (found != render_model_instances_.end())
+            {
+                found->second.devices = devices;
+                found->second.transforms_dirty = true;
+                instanced = true;
+            }
+        }
+
+        for (const auto device_index: devices)
+        {
+            auto& model = device_render_models_[device_index];
+            if (instanced && !model.is_stashed())
+                model.stash();
+            else if (!instanced && model.is_stashed())
+                model.unstash();
+        }
+    }
 }
 
-NodePath OpenVRPlugin::Impl::create_mesh(const std::string& model_name, vr::RenderModel_t* render_model, vr::RenderModel_TextureMap_t* render_texture)
+void OpenVRPlugin::Impl::process_screenshot_requests(const OpenVRPlugin& self)
 {
-    // Add vertices
-    PT(GeomVertexData) vdata = new GeomVertexData(model_name, GeomVertexFormat::get_v3n3t2(), Geom::UsageHint::UH_static);
-    vdata->unclean_set_num_rows(render_model->unVertexCount);
+    collect_screenshot_writers(self, false);
 
-    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
-    GeomVertexWriter normal(vdata, InternalName::get_normal());
-    GeomVertexWriter texcoord0(vdata, InternalName::get_texcoord());
+    if (screenshot_requests_.empty())
+        return;
 
-    for (uint32_t k=0, k_end=render_model->unVertexCount; k < k_end; ++k)
+    if (!screenshot_copy_triggered_)
     {
-        const auto& pos = render_model->rVertexData[k].vPosition;
-        const auto& norm = render_model->rVertexData[k].vNormal;
-        const auto& tc = render_model->rVertexData[k].rfTextureCoord;
-
-        // Y-up to Z-up
-        vertex.add_data3(pos.v[0], -pos.v[2], pos.v[1]);
-        normal.add_data3(norm.v[0], -norm.v[2], norm.v[1]);
-        texcoord0.add_data2(tc[0], tc[1]);
+        if (!render_stage_ || !render_stage_->trigger_screenshot_copy())
+        {
+            self.error("Screenshots are not supported in current submit mode.");
+            for (auto& request: screenshot_requests_)
+                request.promise.set_value(false);
+            screenshot_requests_.clear();
+            return;
+        }
+        screenshot_copy_triggered_ = true;
+        return;
     }
 
-    // Add indices
-    const size_t triangle_count = render_model->unTriangleCount * 3;
+    PT(Texture) left;
+    PT(Texture) right;
+    if (!render_stage_->get_screenshot_textures(left, right))
+        return;
 
-    PT(GeomTriangles) prim = new GeomTriangles(Geom::UsageHint::UH_static);
-    prim->reserve_num_vertices(triangle_count);
-    for (size_t k = 0, k_end = triangle_count; k < k_end; k+=3)
-        prim->add_vertices(render_model->rIndexData[k], render_model->rIndexData[k+1], render_model->rIndexData[k+2]);
-    prim->close_primitive();
+    screenshot_copy_triggered_ = false;
 
-    PT(Geom) geom = new Geom(vdata);
-    geom->add_primitive(prim);
+    // encoding images takes long time, so it is processed in worker thread.
+    screenshot_writers_.push_back(std::async(std::launch::async,
+        [left, right, request = std::move(screenshot_requests_.front())]() mutable {
+            auto errors = write_screenshots(left, right, request.preview_file_path, request.vr_file_path);
+            request.promise.set_value(errors.empty());
+            return errors;
+        }));
+    screenshot_requests_.pop_front();
+}
 
-    rpcore::RPMaterial mat;
-    mat.set_roughness(1);
-    mat.set_specular_ior(1);
+void OpenVRPlugin::Impl::collect_screenshot_writers(const OpenVRPlugin& self, bool wait)
+{
+    for (auto iter = screenshot_writers_.begin(); iter != screenshot_writers_.end();)
+    {
+        if (!wait && iter->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++iter;
+            continue;
+        }
 
-    PT(Texture) texture = Texture::make_texture();
-    texture->set_name(model_name);
-    texture->setup_2d_texture(render_texture->unWidth, render_texture->unHeight, Texture::ComponentType::T_unsigned_byte, Texture::Format::F_rgba8);
+        // errors in worker thread are logged in main thread.
+        for (const auto& message: iter->get())
+            self.error(message);
+        iter = screenshot_writers_.erase(iter);
+    }
+}
 
-    PTA_uchar dest = texture->make_ram_image();
-    const auto src = render_texture->rubTextureMapData;
-    for (size_t k=0, k_end=dest.size(); k < k_end; k+=4)
+std::vector<std::string> OpenVRPlugin::Impl::write_screenshots(Texture* left, Texture* right,
+    const Filename& preview_file_path, const Filename& vr_file_path)
+{
+    PNMImage left_image;
+    if (!left->store(left_image))
+        return { "Failed to store screenshot texture to image." };
+    left_image.remove_alpha();
+
+    PNMImage preview_image;
+    PNMImage vr_image;
+    if (right)
     {
-        dest[k+2] = src[k+0];   // r
-        dest[k+1] = src[k+1];   // g
-        dest[k+0] = src[k+2];   // b
-        dest[k+3] = src[k+3];   // a
+        PNMImage right_image;
+        if (!right->store(right_image))
+            return { "Failed to store screenshot texture to image." };
+        right_image.remove_alpha();
+
+        const int width = left_image.get_x_size();
+        vr_image = PNMImage(width * 2, left_image.get_y_size(), 3, left_image.get_maxval());
+        vr_image.copy_sub_image(left_image, 0, 0);
+        vr_image.copy_sub_image(right_image, width, 0);
+        preview_image = std::move(left_image);
+    }
+    else
+    {
+        // side-by-side image has both eyes.
+        const int width = left_image.get_x_size() / 2;
+        preview_image = PNMImage(width, left_image.get_y_size(), 3, left_image.get_maxval());
+        preview_image.copy_sub_image(left_image, 0, 0, 0, 0, width, left_image.get_y_size());
+        vr_image = std::move(left_image);
     }
 
-    texture->set_wrap_u(SamplerState::WM_clamp);
-    texture->set_wrap_v(SamplerState::WM_clamp);
-    texture->set_magfilter(SamplerState::FT_linear);
-    texture->set_minfilter(SamplerState::FT_linear_mipmap_linear);
+    std::vector<std::string> errors;
+    if (!preview_image.write(preview_file_path))
+        errors.push_back(fmt::format("Failed to write screenshot: {}", preview_file_path.to_os_specific()));
+    if (!vr_image.write(vr_file_path))
+        errors.push_back(fmt::format("Failed to write screenshot: {}", vr_file_path.to_os_specific()));
 
-    CPT(RenderState) state = RenderState::make(
-        MaterialAttrib::make(mat.get_material()),
-        TextureAttrib::make(texture)
-    );
+    return errors;
+}
 
-    PT(GeomNode) geom_node = new GeomNode(model_name);
-    geom_node->add_geom(geom, state);
+void OpenVRPlugin::Impl::process_vr_events(OpenVRPlugin& self)
+{
+    PStatTimer timer(openvr_process_events_pcollector);
 
-    return NodePath(geom_node);
+    frame_updater_.process_events([&, this](const vr::VREvent_t& vr_event) {
+        // compatibility layer using messenger.
+        if (send_vr_event_messages_)
+        {
+            // NOTE: process_vr_events() (sort -XX) is called before process_events() (sort 0),
+            //       so these events will be processed current frame.
+            self.pipeline_.get_showbase()->get_messenger()->send(
+                vr_system_->GetEventTypeNameFromEnum(static_cast<vr::EVREventType>(vr_event.eventType)),
+                EventParameter(static_cast<int>(frame_updater_.vr_events_.size()-1)),
+                true);
+        }
+    });
 }
 
-void OpenVRPlugin::Impl::process_vr_events(OpenVRPlugin& self)
+void OpenVRPlugin::Impl::wait_get_poses()
 {
-    auto messenger = self.pipeline_.get_showbase()->get_messenger();
+    if (!vr_system_)
+        return;
 
-    vr_events_.clear();
+    {
+        PStatTimer timer(openvr_wait_get_poses_pcollector);
+        vr::VRCompositor()->WaitGetPoses(tracked_device_pose_, vr::k_unMaxTrackedDeviceCount, NULL, 0);
+    }
 
-    vr::VREvent_t vr_event;
-    while (vr_system_->PollNextEvent(&vr_event, sizeof(vr_event)))
+    // record the vsync at which the frame of these poses reaches to photons.
+    // WaitGetPoses returns just after vsync or a few milliseconds before next vsync (running start).
     {
-        vr_events_.push_back(vr_event);
+        float seconds_since_last_vsync = 0;
+        uint64_t vsync_counter = 0;
+        photons_vsync_counter_valid_ = vr_system_->GetTimeSinceLastVsync(&seconds_since_last_vsync, &vsync_counter);
+        if (photons_vsync_counter_valid_)
+            photons_vsync_counter_ = vsync_counter + (seconds_since_last_vsync * 1000.0f > frame_budget_ms_ * 0.5f ? 2 : 1);
+    }
+
+    PStatTimer timer(openvr_update_poses_pcollector);
+
+    frame_updater_.update_poses(tracked_device_pose_, create_device_node_);
+
+    hmd_render_pose_valid_ = tracked_device_pose_[vr::k_unTrackedDeviceIndex_Hmd].bPoseIsValid;
+    if (hmd_render_pose_valid_)
+    {
+        hmd_render_pose_ = tracked_device_pose_[vr::k_unTrackedDeviceIndex_Hmd].mDeviceToAbsoluteTracking;
+
+        if (update_camera_pose_)
+            set_camera_mat(frame_updater_.device_mats_[vr::k_unTrackedDeviceIndex_Hmd]);
 
-        // NOTE: process_vr_events() (sort -XX) is called before process_events() (sort 0),
-        //       so these events will be processed current frame.
-        messenger->send(
-            vr_system_->GetEventTypeNameFromEnum(static_cast<vr::EVREventType>(vr_event.eventType)),
-            EventParameter(static_cast<int>(vr_events_.size()-1)),
-            true);
+        // Update only when IPD or distance scale is changed.
+        if (update_eye_pose_ && eye_pose_dirty_)
+            update_eye_poses(rpcore::Globals::base->get_cam());
     }
 }
 
-void OpenVRPlugin::Impl::wait_get_poses()
+void OpenVRPlugin::Impl::set_camera_pose(const vr::HmdMatrix34_t& hmd_pose)
+{
+    LMatrix4 cam_mat;
+    fast_convert_pose_matrix(hmd_pose, cam_mat, distance_scale_);
+
+    rpcore::Globals::base->get_cam().set_mat(cam_mat);
+}
+
+void OpenVRPlugin::Impl::set_camera_mat(const LMatrix4& hmd_mat)
+{
+    LMatrix4 cam_mat(hmd_mat);
+    cam_mat.set_row(3, hmd_mat.get_row3(3) * distance_scale_);
+
+    rpcore::Globals::base->get_cam().set_mat(cam_mat);
+}
+
+void OpenVRPlugin::Impl::late_latch_camera_pose()
+{
+    if (!vr_system_ || !late_latch_ || !update_camera_pose_)
+        return;
+
+    if (!photons_vsync_counter_valid_)
+        return;
+
+    // predict the pose at the time when the frame reaches to photons.
+    // vsync may or may not have passed since WaitGetPoses, so count frames from the current vsync.
+    float seconds_since_last_vsync = 0;
+    uint64_t vsync_counter = 0;
+    if (!vr_system_->GetTimeSinceLastVsync(&seconds_since_last_vsync, &vsync_counter))
+        return;
+
+    // if the target vsync is already passed, predict for the next one.
+    const uint64_t frames_to_photons = photons_vsync_counter_ > vsync_counter ? photons_vsync_counter_ - vsync_counter : 1;
+
+    const float predicted_seconds = frames_to_photons * frame_budget_ms_ / 1000.0f - seconds_since_last_vsync + seconds_from_vsync_to_photons_;
+
+    vr::TrackedDevicePose_t hmd_pose;
+    vr_system_->GetDeviceToAbsoluteTrackingPose(vr::VRCompositor()->GetTrackingSpace(), predicted_seconds, &hmd_pose, 1);
+    if (!hmd_pose.bPoseIsValid)
+        return;
+
+    hmd_render_pose_ = hmd_pose.mDeviceToAbsoluteTracking;
+    set_camera_pose(hmd_render_pose_);
+}
+
+void OpenVRPlugin::Impl::update_frame_timing()
 {
     if (!vr_system_)
         return;
 
-    vr::VRCompositor()->WaitGetPoses(tracked_device_pose_, vr::k_unMaxTrackedDeviceCount, NULL, 0);
+    // the timing of current frame is not completed yet, so use the previous frame.
+    vr::Compositor_FrameTiming timing;
+    timing.m_nSize = sizeof(vr::Compositor_FrameTiming);
+    if (!vr::VRCompositor()->GetFrameTiming(&timing, 1))
+        return;
 
-    if (tracked_device_pose_[vr::k_unTrackedDeviceIndex_Hmd].bPoseIsValid)
-    {
-        NodePath cam = rpcore::Globals::base->get_cam();
+    if (timing.m_nFrameIndex == last_frame_timing_index_)
+        return;
+    last_frame_timing_index_ = timing.m_nFrameIndex;
+
+    FrameTiming result;
+    result.frame_index = timing.m_nFrameIndex;
+    result.cpu_frame_ms = timing.m_flNewFrameReadyMs - timing.m_flNewPosesReadyMs;
+    result.gpu_frame_ms = timing.m_flTotalRenderGpuMs;
+    result.submit_to_present_ms = timing.m_flCompositorRenderStartMs + timing.m_flCompositorRenderGpuMs - timing.m_flNewFrameReadyMs;
+    result.dropped_frames = timing.m_nNumDroppedFrames;
+    result.reprojected_frames = timing.m_nNumFramePresents > 1 ? timing.m_nNumFramePresents - 1 : 0;
+
+    const uint64_t write_count = frame_timing_write_count_.load(std::memory_order_relaxed);
+    frame_timings_[write_count % FRAME_TIMING_HISTORY_SIZE] = result;
+    frame_timing_write_count_.store(write_count + 1, std::memory_order_release);
+
+    total_frame_count_.fetch_add(1, std::memory_order_relaxed);
+    total_dropped_frames_.fetch_add(result.dropped_frames, std::memory_order_relaxed);
+    total_reprojected_frames_.fetch_add(result.reprojected_frames, std::memory_order_relaxed);
+}
 
-        LMatrix4 hmd_mat;
-        convert_matrix(tracked_device_pose_[vr::k_unTrackedDeviceIndex_Hmd].mDeviceToAbsoluteTracking, hmd_mat);
+void OpenVRPlugin::Impl::get_frame_timings(std::vector<FrameTiming>& timings) const
+{
+    const uint64_t history_size = FRAME_TIMING_HISTORY_SIZE;
 
-        hmd_mat = LMatrix4::z_to_y_up_mat() * hmd_mat * LMatrix4::y_to_z_up_mat();
+    const uint64_t end = frame_timing_write_count_.load(std::memory_order_acquire);
+    const uint64_t begin = end > history_size ? end - history_size : 0;
 
-        if (create_device_node_)
-            device_nodes_[vr::k_unTrackedDeviceIndex_Hmd].set_mat(hmd_mat);
+    timings.resize(static_cast<size_t>(end - begin));
+    for (uint64_t k = begin; k < end; ++k)
+        timings[static_cast<size_t>(k - begin)] = frame_timings_[k % history_size];
 
-        hmd_mat[3][0] *= distance_scale_;
-        hmd_mat[3][1] *= distance_scale_;
-        hmd_mat[3][2] *= distance_scale_;
+    // drop the timings which may be overwritten by writer while copying.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t end_after = frame_timing_write_count_.load(std::memory_order_relaxed) + 1;
+    const uint64_t valid_begin = end_after > history_size ? end_after - history_size : 0;
+    if (valid_begin > begin)
+        timings.erase(timings.begin(), timings.begin() + static_cast<size_t>((std::min)(valid_begin - begin, end - begin)));
+}
 
-        if (update_camera_pose_)
-            cam.set_mat(hmd_mat);
+void OpenVRPlugin::Impl::stop_pose_sampler()
+{
+    // stop the thread even if consumers still have the sampler.
+    if (auto sampler = std::atomic_exchange(&pose_sampler_, std::shared_ptr<OpenVRPoseSampler>()))
+        sampler->stop();
+}
 
-        // Update for IPD change.
-        if (update_eye_pose_)
-        {
-            NodePath leye_np = cam.find("left_eye");
-            if (leye_np)
-            {
-                LMatrix4 left_eye_mat;
-                convert_matrix(vr_system_->GetEyeToHeadTransform(vr::Eye_Left), left_eye_mat);
-                left_eye_mat[3][0] *= distance_scale_;
-                left_eye_mat[3][1] *= distance_scale_;
-                left_eye_mat[3][2] *= distance_scale_;
-                leye_np.set_mat(LMatrix4::z_to_y_up_mat() * left_eye_mat * LMatrix4::y_to_z_up_mat());
-            }
+void OpenVRPlugin::Impl::update_dynamic_resolution(OpenVRPlugin& self)
+{
+    if (base_render_size_[0] == 0 || base_render_size_[1] == 0)
+        return;
 
-            NodePath reye_np = cam.find("right_eye");
-            if (reye_np)
-            {
-                LMatrix4 right_eye_mat;
-                convert_matrix(vr_system_->GetEyeToHeadTransform(vr::Eye_Right), right_eye_mat);
-                right_eye_mat[3][0] *= distance_scale_;
-                right_eye_mat[3][1] *= distance_scale_;
-                right_eye_mat[3][2] *= distance_scale_;
-                reye_np.set_mat(LMatrix4::z_to_y_up_mat() * right_eye_mat * LMatrix4::y_to_z_up_mat());
-            }
-        }
+    if (!dynamic_resolution_)
+    {
+        // restore original resolution
+        if (render_scale_ != 1.0f)
+            apply_render_scale(self, 1.0f);
+        return;
+    }
+
+    // settings may be changed.
+    const float clamped_scale = (std::min)((std::max)(render_scale_, dynamic_resolution_scale_min_), dynamic_resolution_scale_max_);
+    if (clamped_scale != render_scale_)
+    {
+        apply_render_scale(self, clamped_scale);
+        return;
     }
 
-    if (!create_device_node_)
+    // use only new timing
+    const uint64_t timing_count = frame_timing_write_count_.load(std::memory_order_relaxed);
+    if (timing_count == dynamic_resolution_timing_count_)
         return;
+    dynamic_resolution_timing_count_ = timing_count;
 
-    for (int device_index = vr::k_unTrackedDeviceIndex_Hmd+1; device_index < vr::k_unMaxTrackedDeviceCount; ++device_index)
+    // wait until the timings of new resolution are collected.
+    if (dynamic_resolution_cooldown_ > 0)
     {
-        if (tracked_device_pose_[device_index].bPoseIsValid && !device_nodes_[device_index].is_empty())
-        {
-            device_nodes_[device_index].set_mat(LMatrix4::z_to_y_up_mat() *
-                convert_matrix(tracked_device_pose_[device_index].mDeviceToAbsoluteTracking)
-                * LMatrix4::y_to_z_up_mat());
-        }
+        --dynamic_resolution_cooldown_;
+        return;
+    }
+
+    const float gpu_frame_ms = frame_timings_[(timing_count - 1) % FRAME_TIMING_HISTORY_SIZE].gpu_frame_ms;
+
+    // hysteresis: decrease quickly when GPU time is near the budget and increase slowly with enough headroom.
+    float new_scale = render_scale_;
+    if (gpu_frame_ms > frame_budget_ms_ * DYNAMIC_RESOLUTION_UPPER_RATIO)
+    {
+        under_budget_frames_ = 0;
+        if (++over_budget_frames_ >= DYNAMIC_RESOLUTION_DECREASE_FRAMES)
+            new_scale = (std::max)(dynamic_resolution_scale_min_, render_scale_ - DYNAMIC_RESOLUTION_SCALE_STEP);
+    }
+    else if (gpu_frame_ms < frame_budget_ms_ * DYNAMIC_RESOLUTION_LOWER_RATIO)
+    {
+        over_budget_frames_ = 0;
+        if (++under_budget_frames_ >= DYNAMIC_RESOLUTION_INCREASE_FRAMES)
+            new_scale = (std::min)(dynamic_resolution_scale_max_, render_scale_ + DYNAMIC_RESOLUTION_SCALE_STEP);
+    }
+    else
+    {
+        over_budget_frames_ = 0;
+        under_budget_frames_ = 0;
+    }
+
+    if (new_scale != render_scale_)
+        apply_render_scale(self, new_scale);
+}
+
+void OpenVRPlugin::Impl::apply_render_scale(OpenVRPlugin& self, float scale)
+{
+    render_scale_ = scale;
+    over_budget_frames_ = 0;
+    under_budget_frames_ = 0;
+    dynamic_resolution_cooldown_ = DYNAMIC_RESOLUTION_COOLDOWN_FRAMES;
+
+    const int width = (std::max)(1, static_cast<int>(std::round(base_render_size_[0] * scale)));
+    const int height = (std::max)(1, static_cast<int>(std::round(base_render_size_[1] * scale)));
+
+    self.debug(fmt::format("Render scale of dynamic resolution: {} ({}, {})", scale, width, height));
+
+    // same as handling window resize in pipeline
+    self.pipeline_.compute_render_resolution(0.0f, width, height);
+    self.pipeline_.get_light_mgr()->compute_tile_size();
+    self.pipeline_.get_stage_mgr()->handle_window_resize();
+}
+
+void OpenVRPlugin::Impl::update_eye_poses(const NodePath& cam)
+{
+    if (!left_eye_np_ || left_eye_np_.get_parent() != cam)
+        left_eye_np_ = cam.find("left_eye");
+
+    if (!right_eye_np_ || right_eye_np_.get_parent() != cam)
+        right_eye_np_ = cam.find("right_eye");
+
+    if (left_eye_np_)
+    {
+        LMatrix4 left_eye_mat;
+        convert_pose_matrix(vr_system_->GetEyeToHeadTransform(vr::Eye_Left), left_eye_mat, distance_scale_);
+        left_eye_np_.set_mat(left_eye_mat);
     }
+
+    if (right_eye_np_)
+    {
+        LMatrix4 right_eye_mat;
+        convert_pose_matrix(vr_system_->GetEyeToHeadTransform(vr::Eye_Right), right_eye_mat, distance_scale_);
+        right_eye_np_.set_mat(right_eye_mat);
+    }
+
+    // retry in next frame if eye nodes do not exist yet.
+    eye_pose_dirty_ = !(left_eye_np_ && right_eye_np_);
 }
 
 std::string OpenVRPlugin::Impl::get_screenshot_error_message(vr::EVRScreenshotError err) const
@@ -657,10 +1454,14 @@ OpenVRPlugin::OpenVRPlugin(rpcore::RenderPipeline& pipeline): BasePlugin(pipelin
 
 OpenVRPlugin::~OpenVRPlugin()
 {
+    impl_->stop_pose_sampler();
+    for (auto& name_instances: impl_->render_model_instances_)
+        name_instances.second.np.remove_node();
+    impl_->render_model_loader_.reset();
     impl_->tracked_camera_.reset();
     for (vr::TrackedDeviceIndex_t k = 0; k < vr::k_unMaxTrackedDeviceCount; ++k)
     {
-        impl_->device_nodes_[k].remove_node();
+        impl_->frame_updater_.device_nodes_[k].remove_node();
         impl_->controller_node_.remove_node();
     }
     vr::VR_Shutdown();
@@ -696,6 +1497,12 @@ void OpenVRPlugin::on_load()
         return;
     }
 
+    impl_->frame_updater_.vr_system_ = impl_->vr_system_;
+
+    const std::string cache_directory = get_setting<rpcore::PathType>("render_model_cache_directory");
+    impl_->render_model_loader_ = std::make_unique<OpenVRRenderModelLoader>(*this,
+        cache_directory.empty() ? Filename() : Filename::expand_from(cache_directory));
+
     std::string data;
     if (get_tracked_device_property(data, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_TrackingSystemName_String))
         debug(fmt::format("Tracking System Name: {}", data));
@@ -730,6 +1537,17 @@ void OpenVRPlugin::on_unload()
         impl_->update_task_->remove();
     impl_->update_task_ = nullptr;
 
+    if (impl_->late_latch_task_)
+        impl_->late_latch_task_->remove();
+    impl_->late_latch_task_ = nullptr;
+
+    impl_->stop_pose_sampler();
+
+    for (auto& request: impl_->screenshot_requests_)
+        request.promise.set_value(false);
+    impl_->screenshot_requests_.clear();
+    impl_->collect_screenshot_writers(*this, true);
+
     if (impl_->original_lens_)
     {
         if (rpcore::Globals::base)
@@ -745,14 +1563,18 @@ vr::IVRSystem* OpenVRPlugin::get_vr_system() const
 
 NodePath OpenVRPlugin::load_model(const std::string& model_name) const
 {
-    return impl_->load_model(*this, model_name);
+    return impl_->load_model(model_name);
 }
 
 NodePath OpenVRPlugin::load_model(vr::TrackedDeviceIndex_t unTrackedDeviceIndex) const
 {
-    std::string model_name;
-    get_tracked_device_property(model_name, unTrackedDeviceIndex, vr::Prop_RenderModelName_String);
-    return load_model(model_name);
+    const auto model_name = get_tracked_device_string_property(unTrackedDeviceIndex, vr::Prop_RenderModelName_String);
+    return model_name ? load_model(*model_name) : NodePath();
+}
+
+NodePath OpenVRPlugin::load_model_async(const std::string& model_name)
+{
+    return impl_->load_model_async(model_name);
 }
 
 NodePath OpenVRPlugin::setup_device_node(vr::TrackedDeviceIndex_t unTrackedDeviceIndex)
@@ -775,7 +1597,7 @@ NodePath OpenVRPlugin::get_device_node(vr::TrackedDeviceIndex_t device_index) co
     if (device_index >= vr::k_unMaxTrackedDeviceCount)
         return NodePath();
 
-    return impl_->device_nodes_[device_index];
+    return impl_->frame_updater_.device_nodes_[device_index];
 }
 
 float OpenVRPlugin::get_distance_scale() const
@@ -787,10 +1609,45 @@ void OpenVRPlugin::set_distance_scale(float distance_scale)
 {
     static_cast<rpcore::FloatType*>(get_setting_handle("distance_scale")->downcast())->set_value(distance_scale);
     impl_->distance_scale_ = distance_scale;
+    impl_->eye_pose_dirty_ = true;
+    impl_->update_cull_projection(*this);
     if (impl_->device_node_group_)
         impl_->device_node_group_.set_scale(impl_->distance_scale_);
 }
 
+const OpenVRPlugin::DeviceUpdateStats& OpenVRPlugin::get_device_update_stats() const
+{
+    return impl_->frame_updater_.device_update_stats_;
+}
+
+void OpenVRPlugin::get_frame_timings(std::vector<FrameTiming>& timings) const
+{
+    impl_->get_frame_timings(timings);
+}
+
+size_t OpenVRPlugin::drain_pose_samples(vr::TrackedDeviceIndex_t device_index, std::vector<PoseSample>& samples)
+{
+    if (auto sampler = std::atomic_load(&impl_->pose_sampler_))
+        return sampler->drain(device_index, samples);
+    return 0;
+}
+
+uint64_t OpenVRPlugin::get_dropped_pose_sample_count() const
+{
+    if (auto sampler = std::atomic_load(&impl_->pose_sampler_))
+        return sampler->get_dropped_count();
+    return 0;
+}
+
+OpenVRPlugin::FrameTimingTotals OpenVRPlugin::get_frame_timing_totals() const
+{
+    FrameTimingTotals totals;
+    totals.frame_count = impl_->total_frame_count_.load(std::memory_order_relaxed);
+    totals.dropped_frames = impl_->total_dropped_frames_.load(std::memory_order_relaxed);
+    totals.reprojected_frames = impl_->total_reprojected_frames_.load(std::memory_order_relaxed);
+    return totals;
+}
+
 const vr::TrackedDevicePose_t& OpenVRPlugin::get_tracked_device_pose(vr::TrackedDeviceIndex_t device_index) const
 {
     if (device_index >= vr::k_unMaxTrackedDeviceCount)
@@ -831,14 +1688,29 @@ bool OpenVRPlugin::has_tracked_camera() const
 
 boost::optional<LVecBase2> OpenVRPlugin::get_play_area_size() const
 {
-    auto chaperone = vr::VRChaperone();
-    if (chaperone)
+    impl_->update_play_area();
+    return impl_->play_area_size_;
+}
+
+boost::optional<std::array<LPoint3, 4>> OpenVRPlugin::get_play_area_rect() const
+{
+    impl_->update_play_area();
+    return impl_->play_area_rect_;
+}
+
+NodePath OpenVRPlugin::get_play_area_node()
+{
+    if (impl_->play_area_np_.is_empty())
     {
-        LVecBase2f area;
-        if (chaperone->GetPlayAreaSize(&area[0], &area[1]))
-            return area;
+        impl_->create_device_node_group();
+        impl_->play_area_np_ = impl_->device_node_group_.attach_new_node(new GeomNode("openvr_play_area"));
+        impl_->build_play_area_geom();
     }
-    return {};
+    else
+    {
+        impl_->update_play_area_node();
+    }
+    return impl_->play_area_np_;
 }
 
 OpenVRCameraInterface* OpenVRPlugin::get_tracked_camera()
@@ -864,111 +1736,76 @@ OpenVRCameraInterface* OpenVRPlugin::get_tracked_camera()
 
 bool OpenVRPlugin::get_tracked_device_property(std::string& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
 {
-    uint32_t unRequiredBufferLen = impl_->vr_system_->GetStringTrackedDeviceProperty(unDevice, prop, NULL, 0);
-    if (unRequiredBufferLen == 0)
+    if (const auto value = get_tracked_device_string_property(unDevice, prop))
     {
-        result = "";
+        result = *value;
+        return true;
     }
-    else
-    {
-        vr::ETrackedPropertyError err;
-        char* pchBuffer = new char[unRequiredBufferLen];
-        unRequiredBufferLen = impl_->vr_system_->GetStringTrackedDeviceProperty(unDevice, prop, pchBuffer, unRequiredBufferLen, &err);
+    return false;
+}
 
-        if (err == vr::ETrackedPropertyError::TrackedProp_Success)
-        {
-            result = pchBuffer;
-            delete[] pchBuffer;
-        }
-        else
-        {
-            error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
-            delete[] pchBuffer;
-            return false;
-        }
-    }
+boost::optional<const std::string&> OpenVRPlugin::get_tracked_device_string_property(vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
+{
+    vr::ETrackedPropertyError err;
+    if (const auto value = impl_->frame_updater_.get_string_property(unDevice, prop, err))
+        return value;
 
-    return true;
+    error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
+    return boost::none;
 }
 
 bool OpenVRPlugin::get_tracked_device_property(bool& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
 {
     vr::ETrackedPropertyError err;
-    auto tmp = impl_->vr_system_->GetBoolTrackedDeviceProperty(unDevice, prop, &err);
-    if (err == vr::ETrackedPropertyError::TrackedProp_Success)
-    {
-        result = tmp;
-    }
-    else
-    {
-        error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
-        return false;
-    }
-    return true;
+    if (impl_->frame_updater_.get_property(result, unDevice, prop, err))
+        return true;
+
+    error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
+    return false;
 }
 
 bool OpenVRPlugin::get_tracked_device_property(int32_t& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
 {
     vr::ETrackedPropertyError err;
-    auto tmp = impl_->vr_system_->GetInt32TrackedDeviceProperty(unDevice, prop, &err);
-    if (err == vr::ETrackedPropertyError::TrackedProp_Success)
-    {
-        result = tmp;
-    }
-    else
-    {
-        error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
-        return false;
-    }
-    return true;
+    if (impl_->frame_updater_.get_property(result, unDevice, prop, err))
+        return true;
+
+    error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
+    return false;
 }
 
 bool OpenVRPlugin::get_tracked_device_property(uint64_t& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
 {
     vr::ETrackedPropertyError err;
-    auto tmp = impl_->vr_system_->GetUint64TrackedDeviceProperty(unDevice, prop, &err);
-    if (err == vr::ETrackedPropertyError::TrackedProp_Success)
-    {
-        result = tmp;
-    }
-    else
-    {
-        error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
-        return false;
-    }
-    return true;
+    if (impl_->frame_updater_.get_property(result, unDevice, prop, err))
+        return true;
+
+    error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
+    return false;
 }
 
 bool OpenVRPlugin::get_tracked_device_property(float& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
 {
     vr::ETrackedPropertyError err;
-    auto tmp = impl_->vr_system_->GetFloatTrackedDeviceProperty(unDevice, prop, &err);
-    if (err == vr::ETrackedPropertyError::TrackedProp_Success)
-    {
-        result = tmp;
-    }
-    else
-    {
-        error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
-        return false;
-    }
-    return true;
+    if (impl_->frame_updater_.get_property(result, unDevice, prop, err))
+        return true;
+
+    error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
+    return false;
 }
 
 bool OpenVRPlugin::get_tracked_device_property(LMatrix4& result, vr::TrackedDeviceIndex_t unDevice, vr::TrackedDeviceProperty prop) const
 {
     vr::ETrackedPropertyError err;
-    auto mat = impl_->vr_system_->GetMatrix34TrackedDeviceProperty(unDevice, prop, &err);
-    if (err == vr::ETrackedPropertyError::TrackedProp_Success)
+    vr::HmdMatrix34_t mat;
+    if (impl_->frame_updater_.get_property(mat, unDevice, prop, err))
     {
         convert_matrix(mat, result);
+        return true;
     }
-    else
-    {
-        error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
-        return false;
-    }
-    return true;
+
+    error(fmt::format("Failed to get tracked device property: {}", impl_->vr_system_->GetPropErrorNameFromEnum(err)));
+    return false;
 }
 
 vr::EVRScreenshotError OpenVRPlugin::take_stereo_screenshots(const Filename& preview_file_path, const Filename& vr_file_path) const
@@ -1022,14 +1859,61 @@ vr::EVRScreenshotError OpenVRPlugin::take_stereo_screenshots(const Filename& pre
     return err;
 }
 
+std::future<bool> OpenVRPlugin::capture_stereo_screenshots(const Filename& preview_file_path, const Filename& vr_file_path)
+{
+    std::promise<bool> promise;
+    auto future = promise.get_future();
+
+    if (!impl_->render_stage_)
+    {
+        error("OpenVR rendering is disabled.");
+        promise.set_value(false);
+        return future;
+    }
+
+    for (const auto& file_path: { preview_file_path, vr_file_path })
+    {
+        if (file_path.empty())
+        {
+            error(fmt::format("File path is empty: preview ({}), VR ({})", preview_file_path.c_str(), vr_file_path.c_str()));
+            promise.set_value(false);
+            return future;
+        }
+
+        const auto parent_path = boost::filesystem::absolute(rppanda::convert_path(file_path)).parent_path();
+        if (!boost::filesystem::exists(parent_path))
+        {
+            error(fmt::format("Parent directory does NOT exist: {}", parent_path.string()));
+            promise.set_value(false);
+            return future;
+        }
+    }
+
+    debug(fmt::format("Capture screenshots: preview ({}), VR ({})", preview_file_path.c_str(), vr_file_path.c_str()));
+
+    impl_->screenshot_requests_.push_back({ preview_file_path, vr_file_path, std::move(promise) });
+
+    return future;
+}
+
+size_t OpenVRPlugin::add_vr_event_handler(vr::EVREventType event_type, const VREventHandler& handler)
+{
+    return impl_->frame_updater_.event_dispatcher_.add_handler(event_type, handler);
+}
+
+void OpenVRPlugin::remove_vr_event_handler(vr::EVREventType event_type, size_t handler_id)
+{
+    impl_->frame_updater_.event_dispatcher_.remove_handler(event_type, handler_id);
+}
+
 const std::vector<vr::VREvent_t>& OpenVRPlugin::get_vr_events() const
 {
-    return impl_->vr_events_;
+    return impl_->frame_updater_.vr_events_;
 }
 
 const vr::VREvent_t& OpenVRPlugin::get_vr_event(int index) const
 {
-    return impl_->vr_events_[index];
+    return impl_->frame_updater_.vr_events_[index];
 }
 
 }
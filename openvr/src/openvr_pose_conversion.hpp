@@ -0,0 +1,73 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <openvr.h>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+#if !defined(STDFLOAT_DOUBLE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define RPPLUGINS_OPENVR_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace rpplugins {
+
+/**
+ * Same as OpenVRPlugin::convert_pose_matrix, but SSE is used if available.
+ *
+ * This is private to the plugin, so that the public header does not depend on the instruction set.
+ */
+inline void fast_convert_pose_matrix(const vr::HmdMatrix34_t& from, LMatrix4& to, float distance_scale=1.0f)
+{
+#ifdef RPPLUGINS_OPENVR_USE_SSE
+    __m128 row0 = _mm_loadu_ps(from.m[0]);
+    __m128 row1 = _mm_loadu_ps(from.m[1]);
+    __m128 row2 = _mm_loadu_ps(from.m[2]);
+    __m128 row3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+    // (x, z, y, w) of each column.
+    const auto permute = [](__m128 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 2, 0)); };
+
+    const __m128 sign = _mm_set_ps(0.0f, 1.0f, -1.0f, 1.0f);
+    float* data = &to(0, 0);
+    _mm_storeu_ps(data + 0, _mm_mul_ps(permute(row0), sign));
+    _mm_storeu_ps(data + 4, _mm_mul_ps(permute(row2), _mm_set_ps(0.0f, -1.0f, 1.0f, -1.0f)));
+    _mm_storeu_ps(data + 8, _mm_mul_ps(permute(row1), sign));
+    _mm_storeu_ps(data + 12, _mm_mul_ps(permute(row3), _mm_set_ps(1.0f, distance_scale, -distance_scale, distance_scale)));
+#else
+    OpenVRPlugin::convert_pose_matrix(from, to, distance_scale);
+#endif
+}
+
+/** Same as OpenVRPlugin::convert_pose_matrices, but SSE is used if available. */
+inline void fast_convert_pose_matrices(const vr::TrackedDevicePose_t* from, LMatrix4* to, size_t count, float distance_scale=1.0f)
+{
+    for (size_t k = 0; k < count; ++k)
+        fast_convert_pose_matrix(from[k].mDeviceToAbsoluteTracking, to[k], distance_scale);
+}
+
+}
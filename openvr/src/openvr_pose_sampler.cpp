@@ -0,0 +1,120 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "openvr_pose_sampler.hpp"
+
+#include <chrono>
+
+namespace rpplugins {
+
+bool OpenVRPoseSampler::Queue::push(const PoseSample& sample)
+{
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= buffer_.size())
+        return false;
+
+    buffer_[tail % buffer_.size()] = sample;
+    tail_.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+size_t OpenVRPoseSampler::Queue::pop_all(std::vector<PoseSample>& samples)
+{
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+
+    for (size_t k = head; k != tail; ++k)
+        samples.push_back(buffer_[k % buffer_.size()]);
+    head_.store(tail, std::memory_order_release);
+
+    return tail - head;
+}
+
+// ************************************************************************************************
+
+OpenVRPoseSampler::OpenVRPoseSampler(vr::IVRSystem* vr_system, vr::ETrackingUniverseOrigin tracking_space, float rate) :
+    vr_system_(vr_system), tracking_space_(tracking_space)
+{
+    for (auto& queue: queues_)
+        queue = std::make_unique<Queue>();
+
+    thread_ = std::thread(&OpenVRPoseSampler::run, this, rate);
+}
+
+OpenVRPoseSampler::~OpenVRPoseSampler()
+{
+    stop();
+}
+
+void OpenVRPoseSampler::stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+        thread_.join();
+}
+
+size_t OpenVRPoseSampler::drain(vr::TrackedDeviceIndex_t device_index, std::vector<PoseSample>& samples)
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount)
+        return 0;
+
+    return queues_[device_index]->pop_all(samples);
+}
+
+void OpenVRPoseSampler::run(float rate)
+{
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+
+    vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+    auto next_time = std::chrono::steady_clock::now();
+
+    while (running_.load(std::memory_order_relaxed))
+    {
+        vr_system_->GetDeviceToAbsoluteTrackingPose(tracking_space_, 0, poses, vr::k_unMaxTrackedDeviceCount);
+
+        PoseSample sample;
+        sample.timestamp_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+
+        for (vr::TrackedDeviceIndex_t k = 0; k < vr::k_unMaxTrackedDeviceCount; ++k)
+        {
+            if (!poses[k].bDeviceIsConnected)
+                continue;
+
+            sample.pose = poses[k];
+            if (!queues_[k]->push(sample))
+                dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // keep the rate without drift. If the sampling is late, skip the missed periods.
+        next_time += period;
+        const auto now = std::chrono::steady_clock::now();
+        if (next_time < now)
+            next_time = now;
+        std::this_thread::sleep_until(next_time);
+    }
+}
+
+}
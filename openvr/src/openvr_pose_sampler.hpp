@@ -0,0 +1,102 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <openvr.h>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+namespace rpplugins {
+
+/**
+ * Sampler of tracked device poses in a worker thread.
+ *
+ * The poses of all devices are sampled with GetDeviceToAbsoluteTrackingPose at given rate
+ * independently of rendering, and pushed into lock-free single-producer single-consumer queue of each device.
+ * If a queue is full, new samples of the device are dropped until the consumer drains the queue.
+ */
+class OpenVRPoseSampler
+{
+public:
+    using PoseSample = OpenVRPlugin::PoseSample;
+
+    OpenVRPoseSampler(vr::IVRSystem* vr_system, vr::ETrackingUniverseOrigin tracking_space, float rate);
+    OpenVRPoseSampler(const OpenVRPoseSampler&) = delete;
+
+    ~OpenVRPoseSampler();
+
+    OpenVRPoseSampler& operator=(const OpenVRPoseSampler&) = delete;
+
+    /** Stop sampling and wait for the worker thread. Queued samples can be drained after stopping. */
+    void stop();
+
+    /**
+     * Move samples of the device to @p samples.
+     *
+     * This should be called by only one consumer thread for each device.
+     *
+     * @return  The number of appended samples.
+     */
+    size_t drain(vr::TrackedDeviceIndex_t device_index, std::vector<PoseSample>& samples);
+
+    /** Get the number of samples dropped because the queue was full. */
+    uint64_t get_dropped_count() const { return dropped_count_.load(std::memory_order_relaxed); }
+
+private:
+    class Queue
+    {
+    public:
+        bool push(const PoseSample& sample);
+        size_t pop_all(std::vector<PoseSample>& samples);
+
+    private:
+        std::atomic<size_t> head_{ 0 };     ///< written by consumer.
+
+        // read and write indices are on different cache lines to avoid false sharing.
+        char padding_[64 - sizeof(std::atomic<size_t>)];
+
+        std::atomic<size_t> tail_{ 0 };     ///< written by producer.
+        std::array<PoseSample, OpenVRPlugin::POSE_SAMPLE_QUEUE_SIZE> buffer_;
+    };
+
+    void run(float rate);
+
+    vr::IVRSystem* vr_system_;
+    vr::ETrackingUniverseOrigin tracking_space_;
+
+    std::array<std::unique_ptr<Queue>, vr::k_unMaxTrackedDeviceCount> queues_;
+    std::atomic<uint64_t> dropped_count_{ 0 };
+
+    std::atomic<bool> running_{ true };
+    std::thread thread_;
+};
+
+}
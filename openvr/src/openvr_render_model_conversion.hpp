@@ -0,0 +1,134 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <openvr.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OPENVR_RENDER_MODEL_USE_SSE2
+#endif
+
+namespace rpplugins {
+
+/**
+ * Convert vertices of OpenVR to interleaved v3n3t2 array with Y-up to Z-up conversion.
+ *
+ * The layout of v3n3t2 array is the same as vr::RenderModel_Vertex_t,
+ * so each vertex is just (x, y, z) -> (x, -z, y) for position and normal.
+ */
+inline void convert_render_model_vertices_scalar(const vr::RenderModel_Vertex_t* src, float* dest, size_t count)
+{
+    static_assert(sizeof(vr::RenderModel_Vertex_t) == sizeof(float) * 8, "Unexpected layout of vr::RenderModel_Vertex_t");
+
+    const float* src_data = reinterpret_cast<const float*>(src);
+    for (size_t k = 0; k < count; ++k, src_data += 8, dest += 8)
+    {
+        dest[0] = src_data[0];
+        dest[1] = -src_data[2];
+        dest[2] = src_data[1];
+        dest[3] = src_data[3];
+        dest[4] = -src_data[5];
+        dest[5] = src_data[4];
+        dest[6] = src_data[6];
+        dest[7] = src_data[7];
+    }
+}
+
+/** Swap R and B channels of 8-bit RGBA pixels. */
+inline void swizzle_red_blue_scalar(const uint8_t* src, uint8_t* dest, size_t pixel_count)
+{
+    for (size_t k = 0; k < pixel_count; ++k)
+    {
+        dest[k*4+0] = src[k*4+2];
+        dest[k*4+1] = src[k*4+1];
+        dest[k*4+2] = src[k*4+0];
+        dest[k*4+3] = src[k*4+3];
+    }
+}
+
+#if defined(OPENVR_RENDER_MODEL_USE_SSE2)
+/** SSE2 version of convert_render_model_vertices_scalar. */
+inline void convert_render_model_vertices_sse2(const vr::RenderModel_Vertex_t* src, float* dest, size_t count)
+{
+    const float* src_data = reinterpret_cast<const float*>(src);
+
+    // (px, py, pz, nx) -> (px, -pz, py, nx)
+    const __m128 sign_1 = _mm_castsi128_ps(_mm_set_epi32(0, 0, static_cast<int>(0x80000000), 0));
+    // (ny, nz, u, v) -> (-nz, ny, u, v)
+    const __m128 sign_0 = _mm_castsi128_ps(_mm_set_epi32(0, 0, 0, static_cast<int>(0x80000000)));
+
+    for (size_t k = 0; k < count; ++k, src_data += 8, dest += 8)
+    {
+        const __m128 a = _mm_loadu_ps(src_data);
+        const __m128 b = _mm_loadu_ps(src_data + 4);
+        _mm_storeu_ps(dest, _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 2, 0)), sign_1));
+        _mm_storeu_ps(dest + 4, _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 2, 0, 1)), sign_0));
+    }
+}
+
+/** SSE2 version of swizzle_red_blue_scalar. */
+inline void swizzle_red_blue_sse2(const uint8_t* src, uint8_t* dest, size_t pixel_count)
+{
+    const __m128i mask_ag = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+    const __m128i mask_rb = _mm_set1_epi32(0x00FF00FF);
+
+    size_t k = 0;
+    for (; k + 4 <= pixel_count; k += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 4));
+        const __m128i rb = _mm_and_si128(pixels, mask_rb);
+        const __m128i br = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + k * 4), _mm_or_si128(_mm_and_si128(pixels, mask_ag), br));
+    }
+
+    swizzle_red_blue_scalar(src + k * 4, dest + k * 4, pixel_count - k);
+}
+#endif
+
+/** Convert vertices of render model with SSE2 if available. See convert_render_model_vertices_scalar. */
+inline void convert_render_model_vertices(const vr::RenderModel_Vertex_t* src, float* dest, size_t count)
+{
+#if defined(OPENVR_RENDER_MODEL_USE_SSE2)
+    convert_render_model_vertices_sse2(src, dest, count);
+#else
+    convert_render_model_vertices_scalar(src, dest, count);
+#endif
+}
+
+/** Swap R and B channels with SSE2 if available. */
+inline void swizzle_red_blue(const uint8_t* src, uint8_t* dest, size_t pixel_count)
+{
+#if defined(OPENVR_RENDER_MODEL_USE_SSE2)
+    swizzle_red_blue_sse2(src, dest, pixel_count);
+#else
+    swizzle_red_blue_scalar(src, dest, pixel_count);
+#endif
+}
+
+}
@@ -0,0 +1,451 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "openvr_render_model_loader.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include <geomTriangles.h>
+#include <geomNode.h>
+#include <materialAttrib.h>
+#include <textureAttrib.h>
+#include <geomVertexWriter.h>
+#include <bamFile.h>
+#include <string_utils.h>
+
+#include <render_pipeline/rpcore/util/rpmaterial.hpp>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+#include "openvr_render_model_conversion.hpp"
+
+namespace rpplugins {
+
+// increase this version if conversion of model is changed.
+static const char* RENDER_MODEL_CACHE_VERSION = "1";
+
+static const char* RENDER_MODEL_TEXTURE_ID_TAG = "diffuse_texture_id";
+
+/** FNV-1a hash of file content. */
+static bool hash_file(const std::string& file_path, uint64_t& hash)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file)
+        return false;
+
+    hash = 14695981039346656037ull;
+    char buffer[4096];
+    while (file)
+    {
+        file.read(buffer, sizeof(buffer));
+        for (std::streamsize k = 0, k_end = file.gcount(); k < k_end; ++k)
+        {
+            hash ^= static_cast<unsigned char>(buffer[k]);
+            hash *= 1099511628211ull;
+        }
+    }
+
+    return true;
+}
+
+/** Check if vertex array has the same layout as vr::RenderModel_Vertex_t. */
+static bool is_compatible_vertex_format(const GeomVertexFormat* format)
+{
+    if (format->get_num_arrays() != 1)
+        return false;
+
+    const GeomVertexArrayFormat* array_format = format->get_array(0);
+    if (array_format->get_stride() != sizeof(vr::RenderModel_Vertex_t))
+        return false;
+
+    const std::pair<const InternalName*, size_t> columns[] = {
+        { InternalName::get_vertex(), offsetof(vr::RenderModel_Vertex_t, vPosition) },
+        { InternalName::get_normal(), offsetof(vr::RenderModel_Vertex_t, vNormal) },
+        { InternalName::get_texcoord(), offsetof(vr::RenderModel_Vertex_t, rfTextureCoord) },
+    };
+
+    for (const auto& column_info : columns)
+    {
+        const GeomVertexColumn* column = array_format->get_column(column_info.first);
+        if (!column || column->get_start() != static_cast<int>(column_info.second) ||
+            column->get_numeric_type() != GeomEnums::NT_float32)
+            return false;
+    }
+
+    return true;
+}
+
+NodePath OpenVRRenderModelLoader::make_node(const std::string& model_name, const RenderModel& model)
+{
+    PT(GeomNode) geom_node = new GeomNode(model_name);
+    geom_node->add_geom(model.geom, model.state);
+    return NodePath(geom_node);
+}
+
+OpenVRRenderModelLoader::OpenVRRenderModelLoader(const OpenVRPlugin& plugin, const Filename& cache_directory) :
+    plugin_(plugin), cache_directory_(cache_directory)
+{
+}
+
+OpenVRRenderModelLoader::~OpenVRRenderModelLoader()
+{
+    cancel();
+}
+
+std::shared_future<OpenVRRenderModelLoader::RenderModel> OpenVRRenderModelLoader::request(const std::string& model_name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto found = models_.find(model_name);
+    if (found != models_.end())
+    {
+        // retry if previous loading was failed.
+        const auto& future = found->second;
+        if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready || future.get().geom)
+            return future;
+    }
+
+    auto future = std::async(std::launch::async, &OpenVRRenderModelLoader::load, this, model_name).share();
+    models_[model_name] = future;
+    return future;
+}
+
+void OpenVRRenderModelLoader::cancel()
+{
+    canceled_ = true;
+
+    std::vector<std::shared_future<RenderModel>> futures;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& kv : models_)
+            futures.push_back(kv.second);
+    }
+
+    for (const auto& future : futures)
+        future.wait();
+}
+
+OpenVRRenderModelLoader::RenderModel OpenVRRenderModelLoader::load(const std::string& model_name)
+{
+    Filename cache_file;
+    if (!cache_directory_.empty())
+    {
+        cache_file = get_cache_file(model_name);
+        if (!cache_file.empty() && cache_file.exists())
+        {
+            auto result = read_cache(model_name, cache_file);
+            if (result.geom)
+                return result;
+        }
+    }
+
+    auto render_models = vr::VRRenderModels();
+
+    vr::RenderModel_t* model = nullptr;
+    vr::EVRRenderModelError model_error;
+    while (1)
+    {
+        model_error = render_models->LoadRenderModel_Async(model_name.c_str(), &model);
+        if (model_error != vr::VRRenderModelError_Loading)
+            break;
+
+        if (canceled_)
+            return RenderModel{};
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (!model || model_error != vr::VRRenderModelError_None)
+    {
+        plugin_.error(fmt::format("Unable to load render model {} - {}", model_name, render_models->GetRenderModelErrorNameFromEnum(model_error)));
+        return RenderModel{};
+    }
+
+    const auto convert_begin = std::chrono::steady_clock::now();
+
+    RenderModel result;
+    result.geom = create_geom(model_name, model);
+
+    plugin_.debug(fmt::format("Render model {} ({} vertices, {} triangles) is converted in {} us.",
+        model_name, model->unVertexCount, model->unTriangleCount,
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - convert_begin).count()));
+
+    const vr::TextureID_t texture_id = model->diffuseTextureId;
+    PT(Texture) texture = load_texture(model_name, texture_id);
+
+    render_models->FreeRenderModel(model);
+
+    if (!texture)
+        return RenderModel{};
+
+    rpcore::RPMaterial mat;
+    mat.set_roughness(1);
+    mat.set_specular_ior(1);
+
+    result.state = RenderState::make(
+        MaterialAttrib::make(mat.get_material()),
+        TextureAttrib::make(texture)
+    );
+
+    if (!cache_file.empty())
+        write_cache(model_name, cache_file, result, texture_id);
+
+    return result;
+}
+
+PT(Texture) OpenVRRenderModelLoader::load_texture(const std::string& model_name, vr::TextureID_t texture_id)
+{
+    std::promise<PT(Texture)> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        auto found = textures_.find(texture_id);
+        if (found != textures_.end())
+        {
+            auto future = found->second;
+            lock.unlock();
+
+            // shared with other model or wait for other worker loading the same texture.
+            if (auto texture = future.get())
+                return texture;
+
+            plugin_.error(fmt::format("Unable to load render texture for render model {}", model_name));
+            return nullptr;
+        }
+
+        textures_[texture_id] = promise.get_future().share();
+    }
+
+    auto render_models = vr::VRRenderModels();
+
+    vr::RenderModel_TextureMap_t* render_texture = nullptr;
+    vr::EVRRenderModelError model_error;
+    while (1)
+    {
+        model_error = render_models->LoadTexture_Async(texture_id, &render_texture);
+        if (model_error != vr::VRRenderModelError_Loading)
+            break;
+
+        if (canceled_)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (!render_texture || model_error != vr::VRRenderModelError_None)
+    {
+        if (!canceled_)
+            plugin_.error(fmt::format("Unable to load render texture for render model {}", model_name));
+
+        {
+            // remove failed texture to retry in next request.
+            std::lock_guard<std::mutex> lock(mutex_);
+            textures_.erase(texture_id);
+        }
+        promise.set_value(nullptr);
+        return nullptr;
+    }
+
+    PT(Texture) texture = create_texture(model_name, render_texture);
+    render_models->FreeTexture(render_texture);
+
+    promise.set_value(texture);
+    return texture;
+}
+
+Filename OpenVRRenderModelLoader::get_cache_file(const std::string& model_name) const
+{
+    auto render_models = vr::VRRenderModels();
+
+    vr::EVRRenderModelError model_error = vr::VRRenderModelError_None;
+    const uint32_t path_length = render_models->GetRenderModelOriginalPath(model_name.c_str(), nullptr, 0, &model_error);
+    if (path_length == 0)
+        return Filename();
+
+    std::string original_path(path_length, '\0');
+    render_models->GetRenderModelOriginalPath(model_name.c_str(), &original_path[0], path_length, &model_error);
+    if (model_error != vr::VRRenderModelError_None)
+        return Filename();
+    original_path.resize(path_length - 1);
+
+    uint64_t hash;
+    if (!hash_file(original_path, hash))
+    {
+        plugin_.debug(fmt::format("Cannot read original file of render model {}: {}", model_name, original_path));
+        return Filename();
+    }
+
+    std::string file_name = model_name;
+    for (auto& c : file_name)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_')
+            c = '_';
+    }
+
+    return Filename(cache_directory_, fmt::format("{}_{:016x}_v{}.bam", file_name, hash, RENDER_MODEL_CACHE_VERSION));
+}
+
+OpenVRRenderModelLoader::RenderModel OpenVRRenderModelLoader::read_cache(const std::string& model_name, const Filename& cache_file)
+{
+    BamFile bam_file;
+    if (!bam_file.open_read(cache_file, false))
+        return RenderModel{};
+
+    PT(PandaNode) node = bam_file.read_node(false);
+    if (!node || !node->is_geom_node() || DCAST(GeomNode, node)->get_num_geoms() != 1 || !node->has_tag(RENDER_MODEL_TEXTURE_ID_TAG))
+    {
+        plugin_.warn(fmt::format("Invalid cache of render model {}: {}", model_name, cache_file.to_os_specific()));
+        return RenderModel{};
+    }
+
+    // corrupted tag is treated as cache miss, so the model is converted again.
+    int texture_id_value;
+    if (!string_to_int(node->get_tag(RENDER_MODEL_TEXTURE_ID_TAG), texture_id_value))
+    {
+        plugin_.warn(fmt::format("Invalid texture ID in cache of render model {}: {}", model_name, cache_file.to_os_specific()));
+        return RenderModel{};
+    }
+    const vr::TextureID_t texture_id = texture_id_value;
+
+    auto geom_node = DCAST(GeomNode, node);
+
+    RenderModel result;
+    result.geom = geom_node->modify_geom(0);
+    result.state = geom_node->get_geom_state(0);
+
+    // share the texture with other models.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto found = textures_.find(texture_id);
+        if (found != textures_.end())
+        {
+            if (found->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready && found->second.get())
+                result.state = result.state->set_attrib(TextureAttrib::make(found->second.get()));
+        }
+        else
+        {
+            const TextureAttrib* texture_attrib;
+            if (result.state->get_attrib(texture_attrib) && texture_attrib->get_texture())
+            {
+                std::promise<PT(Texture)> promise;
+                promise.set_value(texture_attrib->get_texture());
+                textures_[texture_id] = promise.get_future().share();
+            }
+        }
+    }
+
+    plugin_.debug(fmt::format("Render model {} is loaded from cache: {}", model_name, cache_file.to_os_specific()));
+
+    return result;
+}
+
+void OpenVRRenderModelLoader::write_cache(const std::string& model_name, const Filename& cache_file,
+    const RenderModel& model, vr::TextureID_t texture_id) const
+{
+    NodePath np = make_node(model_name, model);
+    np.set_tag(RENDER_MODEL_TEXTURE_ID_TAG, std::to_string(texture_id));
+
+    cache_file.make_dir();
+
+    // write to temporary file and rename it, so other process does not read partial file.
+    Filename temp_file = Filename::temporary(cache_file.get_dirname(), model_name, ".bam.tmp");
+    if (!np.write_bam_file(temp_file) || !temp_file.rename_to(cache_file))
+    {
+        temp_file.unlink();
+        plugin_.warn(fmt::format("Failed to write cache of render model {}: {}", model_name, cache_file.to_os_specific()));
+    }
+}
+
+PT(Geom) OpenVRRenderModelLoader::create_geom(const std::string& model_name, const vr::RenderModel_t* render_model) const
+{
+    // Add vertices
+    PT(GeomVertexData) vdata = new GeomVertexData(model_name, GeomVertexFormat::get_v3n3t2(), Geom::UsageHint::UH_static);
+    vdata->unclean_set_num_rows(render_model->unVertexCount);
+
+    if (is_compatible_vertex_format(vdata->get_format()))
+    {
+        // fill the interleaved array directly.
+        PT(GeomVertexArrayDataHandle) handle = vdata->modify_array(0)->modify_handle();
+        convert_render_model_vertices(render_model->rVertexData, reinterpret_cast<float*>(handle->get_write_pointer()), render_model->unVertexCount);
+    }
+    else
+    {
+        GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+        GeomVertexWriter normal(vdata, InternalName::get_normal());
+        GeomVertexWriter texcoord0(vdata, InternalName::get_texcoord());
+
+        for (uint32_t k=0, k_end=render_model->unVertexCount; k < k_end; ++k)
+        {
+            const auto& pos = render_model->rVertexData[k].vPosition;
+            const auto& norm = render_model->rVertexData[k].vNormal;
+            const auto& tc = render_model->rVertexData[k].rfTextureCoord;
+
+            // Y-up to Z-up
+            vertex.add_data3(pos.v[0], -pos.v[2], pos.v[1]);
+            normal.add_data3(norm.v[0], -norm.v[2], norm.v[1]);
+            texcoord0.add_data2(tc[0], tc[1]);
+        }
+    }
+
+    // Add indices
+    const size_t triangle_count = render_model->unTriangleCount * 3;
+
+    PT(GeomTriangles) prim = new GeomTriangles(Geom::UsageHint::UH_static);
+    prim->reserve_num_vertices(triangle_count);
+    for (size_t k = 0, k_end = triangle_count; k < k_end; k+=3)
+        prim->add_vertices(render_model->rIndexData[k], render_model->rIndexData[k+1], render_model->rIndexData[k+2]);
+    prim->close_primitive();
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(prim);
+
+    return geom;
+}
+
+PT(Texture) OpenVRRenderModelLoader::create_texture(const std::string& model_name, const vr::RenderModel_TextureMap_t* render_texture) const
+{
+    PT(Texture) texture = Texture::make_texture();
+    texture->set_name(model_name);
+    texture->setup_2d_texture(render_texture->unWidth, render_texture->unHeight, Texture::ComponentType::T_unsigned_byte, Texture::Format::F_rgba8);
+
+    // RGBA of OpenVR to BGRA of Panda3D
+    PTA_uchar dest = texture->make_ram_image();
+    swizzle_red_blue(render_texture->rubTextureMapData, &dest[0], dest.size() / 4);
+
+    texture->set_wrap_u(SamplerState::WM_clamp);
+    texture->set_wrap_v(SamplerState::WM_clamp);
+    texture->set_magfilter(SamplerState::FT_linear);
+    texture->set_minfilter(SamplerState::FT_linear_mipmap_linear);
+
+    return texture;
+}
+
+}
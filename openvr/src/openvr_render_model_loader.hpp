@@ -0,0 +1,111 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+#include <geom.h>
+#include <renderState.h>
+#include <texture.h>
+#include <nodePath.h>
+#include <filename.h>
+
+#include <openvr.h>
+
+namespace rpplugins {
+
+class OpenVRPlugin;
+
+/**
+ * Loader of OpenVR render models.
+ *
+ * Render models are loaded and converted in worker threads. Converted Geom and Texture are cached
+ * by model name and texture ID, so the devices using the same model share the resources.
+ *
+ * If cache directory is given, converted models are also stored as BAM files in the directory
+ * and loaded from there on later loading instead of converting from OpenVR again.
+ */
+class OpenVRRenderModelLoader
+{
+public:
+    struct RenderModel
+    {
+        PT(Geom) geom;
+        CPT(RenderState) state;
+    };
+
+    static NodePath make_node(const std::string& model_name, const RenderModel& model);
+
+public:
+    OpenVRRenderModelLoader(const OpenVRPlugin& plugin, const Filename& cache_directory=Filename());
+    OpenVRRenderModelLoader(const OpenVRRenderModelLoader&) = delete;
+
+    ~OpenVRRenderModelLoader();
+
+    OpenVRRenderModelLoader& operator=(const OpenVRRenderModelLoader&) = delete;
+
+    /**
+     * Request to load the render model.
+     *
+     * The same future is returned for the same model name.
+     * If previous loading was failed, new loading will be started.
+     */
+    std::shared_future<RenderModel> request(const std::string& model_name);
+
+    /** Cancel loading and wait for the worker threads. */
+    void cancel();
+
+private:
+    RenderModel load(const std::string& model_name);
+    PT(Texture) load_texture(const std::string& model_name, vr::TextureID_t texture_id);
+
+    /**
+     * Get the path of cache file.
+     *
+     * The file name consists of model name and the hash of original model file,
+     * so the cache is refreshed when SteamVR updates the model.
+     *
+     * @return  Cache file path or empty if cache cannot be used.
+     */
+    Filename get_cache_file(const std::string& model_name) const;
+    RenderModel read_cache(const std::string& model_name, const Filename& cache_file);
+    void write_cache(const std::string& model_name, const Filename& cache_file, const RenderModel& model, vr::TextureID_t texture_id) const;
+
+    PT(Geom) create_geom(const std::string& model_name, const vr::RenderModel_t* render_model) const;
+    PT(Texture) create_texture(const std::string& model_name, const vr::RenderModel_TextureMap_t* render_texture) const;
+
+    const OpenVRPlugin& plugin_;
+    const Filename cache_directory_;
+    std::atomic<bool> canceled_{ false };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<RenderModel>> models_;
+    std::unordered_map<vr::TextureID_t, std::shared_future<PT(Texture)>> textures_;
+};
+
+}
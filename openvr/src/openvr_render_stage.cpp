@@ -24,20 +24,80 @@
 
 #include "openvr_render_stage.hpp"
 
+#include <cmath>
+
 #include <graphicsWindow.h>
+#include <graphicsBuffer.h>
 #include <textureContext.h>
 #include <callbackNode.h>
+#include <clockObject.h>
 
 #include <render_pipeline/rppanda/showbase/showbase.hpp>
 #include <render_pipeline/rpcore/globals.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
 #include <render_pipeline/rpcore/render_target.hpp>
+#include <render_pipeline/rpcore/pluginbase/manager.hpp>
 #include <render_pipeline/rpcore/util/post_process_region.hpp>
 
+#include "openvr_blue_noise.hpp"
+
 namespace rpplugins {
 
+namespace {
+
+void submit_texture(vr::EVREye eye, uint64_t id, vr::EColorSpace color_space, const vr::VRTextureBounds_t* bounds,
+    vr::EVRSubmitFlags flags, const vr::HmdMatrix34_t* pose)
+{
+    vr::VRTextureWithPose_t texture;
+    texture.handle = (void*)(uintptr_t)(id);
+    texture.eType = vr::TextureType_OpenGL;
+    texture.eColorSpace = color_space;
+    if (pose)
+    {
+        texture.mDeviceToAbsoluteTracking = *pose;
+        flags = static_cast<vr::EVRSubmitFlags>(flags | vr::Submit_TextureWithPose);
+    }
+
+    vr::VRCompositor()->Submit(eye, &texture, bounds, flags);
+}
+
+}
+
+void RenderPoseHistory::set_pose(int frame, const vr::HmdMatrix34_t* pose)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& entry = entries_[frame % HISTORY_SIZE];
+    entry.frame = frame;
+    entry.valid = pose != nullptr;
+    if (pose)
+        entry.pose = *pose;
+}
+
+bool RenderPoseHistory::get_pose(int frame, vr::HmdMatrix34_t& pose) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto& entry = entries_[frame % HISTORY_SIZE];
+    if (entry.frame != frame || !entry.valid)
+        return false;
+
+    pose = entry.pose;
+    return true;
+}
+
+// ************************************************************************************************
+
 TypeHandle SubmitCallback::_type_handle;
 
-SubmitCallback::SubmitCallback(rpcore::RenderTarget* left, rpcore::RenderTarget* right) : left_(left), right_(right)
+SubmitCallback::SubmitCallback(rpcore::RenderTarget* left, rpcore::RenderTarget* right, std::shared_ptr<const RenderPoseHistory> render_poses) :
+    left_(left), right_(right), render_poses_(std::move(render_poses))
+{
+    gsg_ = rpcore::Globals::base->get_win()->get_gsg();
+}
+
+SubmitCallback::SubmitCallback(rpcore::RenderTarget* side_by_side, std::shared_ptr<const RenderPoseHistory> render_poses) :
+    left_(side_by_side), render_poses_(std::move(render_poses))
 {
     gsg_ = rpcore::Globals::base->get_win()->get_gsg();
 }
@@ -47,21 +107,71 @@ void SubmitCallback::do_callback(CallbackData* cbdata)
     if (cbdata)
         cbdata->upcall();
 
+    // the frame count of Draw thread is the frame which is drawn now.
+    vr::HmdMatrix34_t render_pose;
+    const bool has_pose = render_poses_->get_pose(ClockObject::get_global_clock()->get_frame_count(), render_pose);
+    const vr::HmdMatrix34_t* pose = has_pose ? &render_pose : nullptr;
+
+    if (!right_)
+    {
+        const auto id = left_->get_color_tex()->prepare_now(
+            gsg_->get_current_tex_view_offset(), gsg_->get_prepared_objects(), gsg_)->get_native_id();
+
+        const vr::VRTextureBounds_t left_bounds = { 0.0f, 0.0f, 0.5f, 1.0f };
+        submit_texture(vr::Eye_Left, id, vr::ColorSpace_Gamma, &left_bounds, vr::Submit_Default, pose);
+
+        const vr::VRTextureBounds_t right_bounds = { 0.5f, 0.0f, 1.0f, 1.0f };
+        submit_texture(vr::Eye_Right, id, vr::ColorSpace_Gamma, &right_bounds, vr::Submit_Default, pose);
+
+        vr::VRCompositor()->PostPresentHandoff();
+        return;
+    }
+
     const auto left_id = left_->get_color_tex()->prepare_now(
         gsg_->get_current_tex_view_offset(), gsg_->get_prepared_objects(), gsg_)->get_native_id();
 
     const auto right_id = right_->get_color_tex()->prepare_now(
         gsg_->get_current_tex_view_offset(), gsg_->get_prepared_objects(), gsg_)->get_native_id();
 
-    auto compositor = vr::VRCompositor();
+    submit_texture(vr::Eye_Left, left_id, vr::ColorSpace_Gamma, nullptr, vr::Submit_Default, pose);
+    submit_texture(vr::Eye_Right, right_id, vr::ColorSpace_Gamma, nullptr, vr::Submit_Default, pose);
+
+    vr::VRCompositor()->PostPresentHandoff();
+}
+
+// ************************************************************************************************
+
+TypeHandle ArraySubmitCallback::_type_handle;
+
+ArraySubmitCallback::ArraySubmitCallback(const NodePath& input_node, vr::EColorSpace color_space,
+    std::shared_ptr<const RenderPoseHistory> render_poses) :
+    input_node_(input_node), color_space_(color_space), render_poses_(std::move(render_poses))
+{
+    gsg_ = rpcore::Globals::base->get_win()->get_gsg();
+}
+
+void ArraySubmitCallback::do_callback(CallbackData* cbdata)
+{
+    if (cbdata)
+        cbdata->upcall();
+
+    // pipes are set after creating stage, so find it when drawing.
+    Texture* scene_tex = input_node_.get_shader_input("ShadedScene").get_texture();
+    if (!scene_tex)
+        return;
+
+    const auto id = scene_tex->prepare_now(
+        gsg_->get_current_tex_view_offset(), gsg_->get_prepared_objects(), gsg_)->get_native_id();
 
-    vr::Texture_t leftEyeTexture = { (void*)(uintptr_t)(left_id), vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
-    compositor->Submit(vr::Eye_Left, &leftEyeTexture);
+    vr::HmdMatrix34_t render_pose;
+    const bool has_pose = render_poses_->get_pose(ClockObject::get_global_clock()->get_frame_count(), render_pose);
+    const vr::HmdMatrix34_t* pose = has_pose ? &render_pose : nullptr;
 
-    vr::Texture_t rightEyeTexture = { (void*)(uintptr_t)(right_id), vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
-    compositor->Submit(vr::Eye_Right, &rightEyeTexture);
+    // the layer of texture array is selected by eye.
+    submit_texture(vr::Eye_Left, id, color_space_, nullptr, vr::Submit_GlArrayTexture, pose);
+    submit_texture(vr::Eye_Right, id, color_space_, nullptr, vr::Submit_GlArrayTexture, pose);
 
-    compositor->PostPresentHandoff();
+    vr::VRCompositor()->PostPresentHandoff();
 }
 
 // ************************************************************************************************
@@ -71,21 +181,74 @@ OpenVRRenderStage::RequireType OpenVRRenderStage::required_pipes_ = { "ShadedSce
 
 void OpenVRRenderStage::create()
 {
+    if (submit_mode_ == SubmitMode::texture_array)
+    {
+        // this target is used only to submit after ShadedScene is rendered.
+        target_submit_ = create_target("submit");
+        target_submit_->add_color_attachment(8);
+        target_submit_->set_size(LVecBase2i(1, 1));
+        target_submit_->prepare_buffer();
+
+        // ShadedScene is linear color unless color correction is applied.
+        const auto color_space = pipeline_.get_plugin_mgr()->is_plugin_enabled("color_correction") ?
+            vr::ColorSpace_Gamma : vr::ColorSpace_Linear;
+
+        auto submit_region_np = target_submit_->get_postprocess_region()->get_node();
+
+        PT(CallbackNode) submit_node = new CallbackNode("OpenVRSubmitNode");
+        submit_node->set_draw_callback(new ArraySubmitCallback(submit_region_np, color_space, render_poses_));
+
+        auto submit_np = submit_region_np.attach_new_node(submit_node);
+        submit_np.set_depth_test(false);
+        submit_np.set_depth_write(false);
+        submit_np.set_bin("unsorted", 10);
+        return;
+    }
+
+    PT(Texture) blue_noise_tex = BlueNoiseTexture::load(BLUE_NOISE_SIZE,
+        "/$$rptemp/$$rpplugins_openvr_blue_noise_" + std::to_string(BLUE_NOISE_SIZE) + ".png");
+    blue_noise_offset_ = PTA_LVecBase2i::empty_array(1);
+
+    if (submit_mode_ == SubmitMode::side_by_side)
+    {
+        // both eyes in one pass
+        target_side_by_side_ = create_target("side_by_side_distortion");
+        target_side_by_side_->add_color_attachment(8, true);
+        target_side_by_side_->set_size(LVecBase2i(rpcore::Globals::resolution[0] * 2, rpcore::Globals::resolution[1]));
+        target_side_by_side_->prepare_buffer();
+        target_side_by_side_->set_shader_input(ShaderInput("vr_eye", LVecBase4i(-1, 0, 0, 0)));
+        target_side_by_side_->set_shader_input(ShaderInput("BlueNoiseTex", blue_noise_tex));
+        target_side_by_side_->set_shader_input(ShaderInput("blue_noise_offset", blue_noise_offset_));
+
+        PT(CallbackNode) submit_node = new CallbackNode("OpenVRSubmitNode");
+        submit_node->set_draw_callback(new SubmitCallback(target_side_by_side_, render_poses_));
+
+        auto submit_np = target_side_by_side_->get_postprocess_region()->get_node().attach_new_node(submit_node);
+        submit_np.set_depth_test(false);
+        submit_np.set_depth_write(false);
+        submit_np.set_bin("unsorted", 10);
+        return;
+    }
+
     // without glTextureView
     target_left_ = create_target("left_distortion");
     target_left_->add_color_attachment(8, true);
     target_left_->set_size(rpcore::Globals::resolution);
     target_left_->prepare_buffer();
     target_left_->set_shader_input(ShaderInput("vr_eye", LVecBase4i(0, 0, 0, 0)));
+    target_left_->set_shader_input(ShaderInput("BlueNoiseTex", blue_noise_tex));
+    target_left_->set_shader_input(ShaderInput("blue_noise_offset", blue_noise_offset_));
 
     target_right_ = create_target("right_distortion");
     target_right_->add_color_attachment(8, true);
     target_right_->set_size(rpcore::Globals::resolution);
     target_right_->prepare_buffer();
     target_right_->set_shader_input(ShaderInput("vr_eye", LVecBase4i(1, 0, 0, 0)));
+    target_right_->set_shader_input(ShaderInput("BlueNoiseTex", blue_noise_tex));
+    target_right_->set_shader_input(ShaderInput("blue_noise_offset", blue_noise_offset_));
 
     PT(CallbackNode) submit_node = new CallbackNode("OpenVRSubmitNode");
-    submit_node->set_draw_callback(new SubmitCallback(target_left_, target_right_));
+    submit_node->set_draw_callback(new SubmitCallback(target_left_, target_right_, render_poses_));
 
     auto submit_np = target_right_->get_postprocess_region()->get_node().attach_new_node(submit_node);
     submit_np.set_depth_test(false);
@@ -93,18 +256,116 @@ void OpenVRRenderStage::create()
     submit_np.set_bin("unsorted", 10);
 }
 
+void OpenVRRenderStage::update()
+{
+    if (blue_noise_offset_.empty())
+        return;
+
+    // move blue noise every frame with R2 sequence, so the dithering is not static.
+    const int frame = ClockObject::get_global_clock()->get_frame_count();
+    blue_noise_offset_[0] = LVecBase2i(
+        static_cast<int>(std::fmod(frame * 0.7548776662, 1.0) * BLUE_NOISE_SIZE),
+        static_cast<int>(std::fmod(frame * 0.5698402910, 1.0) * BLUE_NOISE_SIZE));
+}
+
 void OpenVRRenderStage::reload_shaders()
 {
+    if (target_submit_)
+    {
+        target_submit_->set_shader(load_plugin_shader({"openvr_submit.frag.glsl"}));
+        return;
+    }
+
+    if (target_side_by_side_)
+    {
+        target_side_by_side_->set_shader(load_plugin_shader({"openvr_render.frag.glsl"}));
+        return;
+    }
+
     target_left_->set_shader(load_plugin_shader({"openvr_render.frag.glsl"}));
     target_right_->set_shader(load_plugin_shader({"openvr_render.frag.glsl"}));
 }
 
 void OpenVRRenderStage::set_dimensions()
 {
+    if (target_submit_)
+        return;
+
+    if (target_side_by_side_)
+    {
+        target_side_by_side_->set_size(LVecBase2i(rpcore::Globals::resolution[0] * 2, rpcore::Globals::resolution[1]));
+        return;
+    }
+
     target_left_->set_size(rpcore::Globals::resolution);
     target_right_->set_size(rpcore::Globals::resolution);
 }
 
+void OpenVRRenderStage::set_render_pose(const vr::HmdMatrix34_t* pose)
+{
+    render_poses_->set_pose(ClockObject::get_global_clock()->get_frame_count(), pose);
+}
+
+bool OpenVRRenderStage::trigger_screenshot_copy()
+{
+    if (screenshot_copy_pending_)
+        return false;
+
+    std::vector<rpcore::RenderTarget*> targets;
+    if (target_side_by_side_)
+        targets = { target_side_by_side_ };
+    else if (target_left_ && target_right_)
+        targets = { target_left_, target_right_ };
+    else
+        return false;
+
+    // copy textures are added when screenshot is requested first,
+    // so rendering is not affected if screenshots are not used.
+    if (!screenshot_left_)
+    {
+        screenshot_left_ = new Texture("OpenVRScreenshotLeft");
+        targets[0]->get_internal_buffer()->add_render_texture(screenshot_left_,
+            GraphicsOutput::RTM_triggered_copy_ram, GraphicsOutput::RTP_color);
+
+        if (targets.size() > 1)
+        {
+            screenshot_right_ = new Texture("OpenVRScreenshotRight");
+            targets[1]->get_internal_buffer()->add_render_texture(screenshot_right_,
+                GraphicsOutput::RTM_triggered_copy_ram, GraphicsOutput::RTP_color);
+        }
+    }
+
+    screenshot_left_->clear_ram_image();
+    if (screenshot_right_)
+        screenshot_right_->clear_ram_image();
+
+    for (auto target: targets)
+        target->get_internal_buffer()->trigger_copy();
+
+    screenshot_copy_pending_ = true;
+
+    return true;
+}
+
+bool OpenVRRenderStage::get_screenshot_textures(PT(Texture)& left, PT(Texture)& right)
+{
+    if (!screenshot_copy_pending_)
+        return false;
+
+    if (!screenshot_left_->has_ram_image() || (screenshot_right_ && !screenshot_right_->has_ram_image()))
+        return false;
+
+    // RAM images are shared until the copies are modified.
+    left = screenshot_left_->make_copy();
+    right = nullptr;
+    if (screenshot_right_)
+        right = screenshot_right_->make_copy();
+
+    screenshot_copy_pending_ = false;
+
+    return true;
+}
+
 std::string OpenVRRenderStage::get_plugin_id() const
 {
     return RPPLUGINS_ID_STRING;
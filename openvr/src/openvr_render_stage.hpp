@@ -24,9 +24,15 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <mutex>
+
 #include <render_pipeline/rpcore/render_stage.hpp>
 
 #include <callbackObject.h>
+#include <pta_LVecBase2.h>
+#include <texture.h>
 
 #include <openvr.h>
 
@@ -36,10 +42,45 @@ class RenderTarget;
 
 namespace rpplugins {
 
+/**
+ * HMD poses used for rendering of recent frames.
+ *
+ * The pose is set in App thread and got in Draw thread with the frame number of each thread,
+ * so the pose matches the submitted frame in multi-threaded pipeline.
+ */
+class RenderPoseHistory
+{
+public:
+    /** Set the pose of the frame. If @p pose is nullptr, the frame is submitted without pose. */
+    void set_pose(int frame, const vr::HmdMatrix34_t* pose);
+
+    /** Get the pose of the frame. Return false if the pose does not exist. */
+    bool get_pose(int frame, vr::HmdMatrix34_t& pose) const;
+
+private:
+    static const int HISTORY_SIZE = 4;
+
+    struct Entry
+    {
+        int frame = -1;
+        bool valid = false;
+        vr::HmdMatrix34_t pose;
+    };
+
+    mutable std::mutex mutex_;
+    std::array<Entry, HISTORY_SIZE> entries_;
+};
+
+// ************************************************************************************************
+
 class SubmitCallback : public CallbackObject
 {
 public:
-    SubmitCallback(rpcore::RenderTarget* left, rpcore::RenderTarget* right);
+    /** Submit each texture of eyes. */
+    SubmitCallback(rpcore::RenderTarget* left, rpcore::RenderTarget* right, std::shared_ptr<const RenderPoseHistory> render_poses);
+
+    /** Submit a side-by-side texture with bounds of each eye. */
+    SubmitCallback(rpcore::RenderTarget* side_by_side, std::shared_ptr<const RenderPoseHistory> render_poses);
 
     void do_callback(CallbackData* cbdata) override;
 
@@ -48,7 +89,8 @@ public:
 private:
     GraphicsStateGuardian * gsg_;
     const rpcore::RenderTarget* left_;
-    const rpcore::RenderTarget* right_;
+    const rpcore::RenderTarget* right_ = nullptr;
+    std::shared_ptr<const RenderPoseHistory> render_poses_;
 
 public:
     static TypeHandle get_class_type() { return _type_handle; }
@@ -66,10 +108,55 @@ private:
 
 // ************************************************************************************************
 
+/**
+ * Submit layers of ShadedScene texture array without copying.
+ *
+ * ShadedScene is found from shader inputs of the given node when it is drawn.
+ */
+class ArraySubmitCallback : public CallbackObject
+{
+public:
+    ArraySubmitCallback(const NodePath& input_node, vr::EColorSpace color_space, std::shared_ptr<const RenderPoseHistory> render_poses);
+
+    void do_callback(CallbackData* cbdata) override;
+
+    ALLOC_DELETED_CHAIN(ArraySubmitCallback);
+
+private:
+    GraphicsStateGuardian * gsg_;
+    NodePath input_node_;
+    vr::EColorSpace color_space_;
+    std::shared_ptr<const RenderPoseHistory> render_poses_;
+
+public:
+    static TypeHandle get_class_type() { return _type_handle; }
+    static void init_type()
+    {
+        CallbackObject::init_type();
+        register_type(_type_handle, "rpplugins::ArraySubmitCallback", CallbackObject::get_class_type());
+    }
+    TypeHandle get_type() const override { return get_class_type(); }
+    TypeHandle force_init_type() override { init_type(); return get_class_type(); }
+
+private:
+    static TypeHandle _type_handle;
+};
+
+// ************************************************************************************************
+
 class OpenVRRenderStage : public rpcore::RenderStage
 {
 public:
-    OpenVRRenderStage(rpcore::RenderPipeline& pipeline): RenderStage(pipeline, "OpenVRRenderStage") {}
+    enum class SubmitMode
+    {
+        separate = 0,       ///< render and submit a target per eye.
+        side_by_side,       ///< render both eyes into a double-width target and submit it with bounds.
+        texture_array,      ///< submit layers of ShadedScene directly.
+    };
+
+public:
+    OpenVRRenderStage(rpcore::RenderPipeline& pipeline, SubmitMode submit_mode = SubmitMode::separate):
+        RenderStage(pipeline, "OpenVRRenderStage"), submit_mode_(submit_mode) {}
 
     RequireType& get_required_inputs() const final { return required_inputs_; }
     RequireType& get_required_pipes() const final { return required_pipes_; }
@@ -77,18 +164,55 @@ public:
     RENDER_PIPELINE_STAGE_DOWNCAST();
 
     void create() final;
+    void update() final;
     void reload_shaders() final;
 
     void set_dimensions() final;
 
+    /**
+     * Set the HMD pose used for rendering of current frame.
+     *
+     * The pose is submitted with the textures, so the compositor can reproject the frame correctly.
+     * If @p pose is nullptr, the textures are submitted without pose.
+     */
+    void set_render_pose(const vr::HmdMatrix34_t* pose);
+
+    /**
+     * Copy the images of eye targets to RAM after rendering of next frame.
+     *
+     * @return  false if eye targets do not exist (texture_array mode) or a copy is pending.
+     */
+    bool trigger_screenshot_copy();
+
+    /**
+     * Get copies of the textures which have the images of eyes in RAM.
+     *
+     * In side_by_side mode, @p left has the images of both eyes and @p right is nullptr.
+     *
+     * @return  false if the copy is not finished yet.
+     */
+    bool get_screenshot_textures(PT(Texture)& left, PT(Texture)& right);
+
 private:
     std::string get_plugin_id() const final;
 
     static RequireType required_inputs_;
     static RequireType required_pipes_;
 
+    const SubmitMode submit_mode_;
+    std::shared_ptr<RenderPoseHistory> render_poses_ = std::make_shared<RenderPoseHistory>();
+
     rpcore::RenderTarget* target_left_ = nullptr;
     rpcore::RenderTarget* target_right_ = nullptr;
+    rpcore::RenderTarget* target_side_by_side_ = nullptr;
+    rpcore::RenderTarget* target_submit_ = nullptr;
+
+    PT(Texture) screenshot_left_;
+    PT(Texture) screenshot_right_;
+    bool screenshot_copy_pending_ = false;
+
+    static const int BLUE_NOISE_SIZE = 64;
+    PTA_LVecBase2i blue_noise_offset_;
 };
 
 }
@@ -0,0 +1,85 @@
+# list header
+set(${PROJECT_NAME}_header_root
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_event_dispatcher.hpp"
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_frame_updater.hpp"
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_pose_conversion.hpp"
+)
+
+set(${PROJECT_NAME}_headers
+    ${${PROJECT_NAME}_header_root}
+)
+
+# grouping
+source_group("openvr" FILES ${${PROJECT_NAME}_header_root})
+
+
+
+# list source
+set(${PROJECT_NAME}_source_root
+    "${PROJECT_SOURCE_DIR}/src/main.cpp"
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_event_dispatcher.cpp"
+)
+
+set(${PROJECT_NAME}_sources
+    ${${PROJECT_NAME}_source_root}
+)
+
+# grouping
+source_group("src" FILES ${${PROJECT_NAME}_source_root})
+
+
+
+# list of pose conversion check
+set(pose_conversion_check_headers
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_pose_conversion.hpp"
+)
+
+set(pose_conversion_check_sources
+    "${PROJECT_SOURCE_DIR}/src/pose_conversion_check.cpp"
+)
+
+source_group("openvr" FILES ${pose_conversion_check_headers})
+source_group("src" FILES ${pose_conversion_check_sources})
+
+
+
+# list of culling frustum check
+set(cull_frustum_check_headers
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_cull_frustum.hpp"
+)
+
+set(cull_frustum_check_sources
+    "${PROJECT_SOURCE_DIR}/src/cull_frustum_check.cpp"
+)
+
+source_group("openvr" FILES ${cull_frustum_check_headers})
+source_group("src" FILES ${cull_frustum_check_sources})
+
+
+
+# list of render model conversion benchmark
+set(render_model_conversion_benchmark_headers
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_render_model_conversion.hpp"
+)
+
+set(render_model_conversion_benchmark_sources
+    "${PROJECT_SOURCE_DIR}/src/render_model_conversion_benchmark.cpp"
+)
+
+source_group("openvr" FILES ${render_model_conversion_benchmark_headers})
+source_group("src" FILES ${render_model_conversion_benchmark_sources})
+
+
+
+# list of dithering benchmark
+set(dithering_benchmark_headers
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_blue_noise.hpp"
+)
+
+set(dithering_benchmark_sources
+    "${PROJECT_SOURCE_DIR}/src/dithering_benchmark.cpp"
+    "${rpplugins_${RPPLUGINS_ID}_SOURCE_DIR}/src/openvr_blue_noise.cpp"
+)
+
+source_group("openvr" FILES ${dithering_benchmark_headers})
+source_group("src" FILES ${dithering_benchmark_sources})
@@ -0,0 +1,216 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Check of culling frustum.
+ *
+ * The culling frustum from compute_cull_frustum (used in the plugin) is computed for
+ * synthetic eyes which have symmetric, asymmetric and canted projections.
+ * Then, the corners of both eye frusta are checked whether they are in the culling frustum,
+ * and each side of the culling frustum is checked whether it touches the eye frusta (not too large).
+ * The exit code is non-zero if any check fails.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <openvr.h>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+#include "openvr_cull_frustum.hpp"
+
+using rpplugins::OpenVRPlugin;
+
+namespace {
+
+constexpr float CONTAIN_THRESHOLD = 1e-4f;
+constexpr float TIGHT_THRESHOLD = 1e-2f;
+
+struct EyeDesc
+{
+    float left, right, bottom, top;     ///< tangents of projection
+    float cant;                         ///< rotation (degrees) around Y-axis. positive is outward of left eye.
+    float x, y, z;                      ///< position in head space
+};
+
+struct TestCase
+{
+    std::string name;
+    EyeDesc left_eye;
+    EyeDesc right_eye;
+    float distance_scale;
+    float near_dist;
+    float far_dist;
+};
+
+/** OpenGL projection matrix like IVRSystem::GetProjectionMatrix. */
+vr::HmdMatrix44_t make_projection(const EyeDesc& eye, float near_dist, float far_dist)
+{
+    vr::HmdMatrix44_t proj = {};
+    proj.m[0][0] = 2 / (eye.right - eye.left);
+    proj.m[0][2] = (eye.right + eye.left) / (eye.right - eye.left);
+    proj.m[1][1] = 2 / (eye.top - eye.bottom);
+    proj.m[1][2] = (eye.top + eye.bottom) / (eye.top - eye.bottom);
+    proj.m[2][2] = -(far_dist + near_dist) / (far_dist - near_dist);
+    proj.m[2][3] = -2 * far_dist * near_dist / (far_dist - near_dist);
+    proj.m[3][2] = -1;
+    return proj;
+}
+
+/** Eye-to-head matrix like IVRSystem::GetEyeToHeadTransform. */
+vr::HmdMatrix34_t make_eye_to_head(const EyeDesc& eye, bool left)
+{
+    const float angle = (left ? eye.cant : -eye.cant) * 3.14159265f / 180.0f;
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+
+    vr::HmdMatrix34_t eye_to_head = {};
+    eye_to_head.m[0][0] = c;  eye_to_head.m[0][2] = s;  eye_to_head.m[0][3] = eye.x;
+    eye_to_head.m[1][1] = 1;                            eye_to_head.m[1][3] = eye.y;
+    eye_to_head.m[2][0] = -s; eye_to_head.m[2][2] = c;  eye_to_head.m[2][3] = eye.z;
+    return eye_to_head;
+}
+
+bool check(const TestCase& test)
+{
+    const vr::HmdMatrix34_t eye_to_heads[2] = { make_eye_to_head(test.left_eye, true), make_eye_to_head(test.right_eye, false) };
+
+    // same as OpenVRPlugin::Impl::update_cull_projection
+    LMatrix4 proj_mats[2];
+    LMatrix4 eye_to_head_mats[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        proj_mats[k] = OpenVRPlugin::convert_matrix(make_projection(k == 0 ? test.left_eye : test.right_eye, test.near_dist, test.far_dist));
+        eye_to_head_mats[k] = OpenVRPlugin::convert_matrix(eye_to_heads[k]);
+        eye_to_head_mats[k].set_row(3, eye_to_head_mats[k].get_row3(3) * test.distance_scale);
+    }
+
+    const rpplugins::OpenVRCullFrustum frustum = rpplugins::compute_cull_frustum(
+        proj_mats[0], eye_to_head_mats[0], proj_mats[1], eye_to_head_mats[1], test.near_dist, test.far_dist);
+
+    bool succeeded = true;
+    if (!(frustum.offset >= 0))
+    {
+        std::cerr << test.name << ": offset is invalid (" << frustum.offset << ")" << std::endl;
+        succeeded = false;
+    }
+
+    // corners of the eye frusta are computed from the descriptions, not from the matrices.
+    // minimum and maximum of NDC (x, y) of the corners
+    float ndc_bounds[4] = { 1, -1, 1, -1 };
+    for (int k = 0; k < 2; ++k)
+    {
+        const EyeDesc& eye = k == 0 ? test.left_eye : test.right_eye;
+        const auto& m = eye_to_heads[k].m;
+        for (const float dist : { test.near_dist, test.far_dist })
+        {
+            for (const float tan_x : { eye.left, eye.right })
+            {
+                for (const float tan_y : { eye.bottom, eye.top })
+                {
+                    const float p[3] = { tan_x * dist, tan_y * dist, -dist };
+                    float head[3];
+                    for (int i = 0; i < 3; ++i)
+                        head[i] = m[i][0] * p[0] + m[i][1] * p[1] + m[i][2] * p[2] + m[i][3] * test.distance_scale;
+
+                    const LVecBase4 clip = LVecBase4(head[0], head[1], head[2] - frustum.offset, 1) * frustum.proj_mat;
+                    const LVecBase3 ndc = clip.get_xyz() / clip[3];
+                    if (std::abs(ndc[0]) > 1 + CONTAIN_THRESHOLD || std::abs(ndc[1]) > 1 + CONTAIN_THRESHOLD ||
+                        std::abs(ndc[2]) > 1 + CONTAIN_THRESHOLD)
+                    {
+                        std::cerr << test.name << ": corner of " << (k == 0 ? "left" : "right") << " eye is outside: NDC ("
+                            << ndc[0] << ", " << ndc[1] << ", " << ndc[2] << ")" << std::endl;
+                        succeeded = false;
+                    }
+                    ndc_bounds[0] = (std::min)(ndc_bounds[0], ndc[0]);
+                    ndc_bounds[1] = (std::max)(ndc_bounds[1], ndc[0]);
+                    ndc_bounds[2] = (std::min)(ndc_bounds[2], ndc[1]);
+                    ndc_bounds[3] = (std::max)(ndc_bounds[3], ndc[1]);
+                }
+            }
+        }
+    }
+
+    if (-ndc_bounds[0] < 1 - TIGHT_THRESHOLD || ndc_bounds[1] < 1 - TIGHT_THRESHOLD ||
+        -ndc_bounds[2] < 1 - TIGHT_THRESHOLD || ndc_bounds[3] < 1 - TIGHT_THRESHOLD)
+    {
+        std::cerr << test.name << ": culling frustum is too large: NDC bounds (" << ndc_bounds[0] << ", " << ndc_bounds[1]
+            << ", " << ndc_bounds[2] << ", " << ndc_bounds[3] << ")" << std::endl;
+        succeeded = false;
+    }
+
+    std::cout << test.name << ": offset " << frustum.offset << (succeeded ? " - OK" : " - FAILED") << std::endl;
+
+    return succeeded;
+}
+
+}
+
+int main()
+{
+    // tangents and positions are similar to those of some HMDs.
+    const EyeDesc symmetric = { -1.0f, 1.0f, -1.0f, 1.0f, 0.0f, -0.032f, 0.0f, 0.0f };
+    const EyeDesc asymmetric = { -1.39f, 1.24f, -1.47f, 1.46f, 0.0f, -0.032f, 0.0f, 0.0f };
+    const EyeDesc canted = { -1.60f, 1.05f, -1.20f, 1.35f, 10.0f, -0.034f, 0.0f, 0.0f };
+    const EyeDesc offset = { -1.39f, 1.24f, -1.47f, 1.46f, 5.0f, -0.032f, 0.01f, -0.015f };
+
+    // right eye is the mirror of left eye.
+    const auto mirror = [](EyeDesc eye) {
+        std::swap(eye.left, eye.right);
+        eye.left = -eye.left;
+        eye.right = -eye.right;
+        eye.x = -eye.x;
+        return eye;
+    };
+
+    std::vector<TestCase> tests;
+    for (const float distance_scale : { 1.0f, 0.1f, 10.0f })
+    {
+        for (const auto& clip : { std::make_pair(0.1f, 100.0f), std::make_pair(0.01f, 5000.0f) })
+        {
+            const std::string suffix = " (scale " + std::to_string(distance_scale) +
+                ", near " + std::to_string(clip.first) + ", far " + std::to_string(clip.second) + ")";
+            tests.push_back({ "symmetric" + suffix, symmetric, mirror(symmetric), distance_scale, clip.first, clip.second });
+            tests.push_back({ "asymmetric" + suffix, asymmetric, mirror(asymmetric), distance_scale, clip.first, clip.second });
+            tests.push_back({ "canted" + suffix, canted, mirror(canted), distance_scale, clip.first, clip.second });
+            tests.push_back({ "canted with offset" + suffix, offset, mirror(offset), distance_scale, clip.first, clip.second });
+        }
+    }
+
+    int failed_count = 0;
+    for (const auto& test : tests)
+    {
+        if (!check(test))
+            ++failed_count;
+    }
+
+    std::cout << "failed: " << failed_count << " / " << tests.size() << std::endl;
+
+    return failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,383 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Benchmark of dithering in the output pass of OpenVRRenderStage.
+ *
+ * The output pass (shader/openvr_render.frag.glsl) is run on an offscreen EGL context
+ * with two dithering methods for both eyes:
+ * - rand_rgb: two evaluations of hash noise per pixel (the previous method).
+ * - blue noise: one texel fetch of the tiled blue noise texture with offset per frame.
+ *
+ * This is intended to run on software GL (ex, LIBGL_ALWAYS_SOFTWARE=1 with Mesa llvmpipe)
+ * where ALU cost of fragment shader is dominant, and reports the time per frame of each method.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+
+#include "openvr_blue_noise.hpp"
+
+namespace {
+
+const int BLUE_NOISE_SIZE = 64;     // same as OpenVRRenderStage
+
+const char* VERTEX_SHADER = R"(
+#version 430
+void main() {
+    // full-screen triangle
+    const vec2 positions[3] = vec2[](vec2(-1, -1), vec2(3, -1), vec2(-1, 3));
+    gl_Position = vec4(positions[gl_VertexID], 0, 1);
+}
+)";
+
+// common part of shader/openvr_render.frag.glsl
+const char* FRAGMENT_SHADER_HEADER = R"(
+#version 430
+uniform sampler2DArray ShadedScene;
+uniform sampler2D BlueNoiseTex;
+uniform ivec2 blue_noise_offset;
+uniform int vr_eye;
+uniform vec2 SCREEN_SIZE;
+out vec4 result;
+
+// same as includes/color_spaces.inc.glsl of Render Pipeline
+float rgb_to_srgb(float v) {
+    if (v < 0.0031308) return 12.92 * v;
+    return 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+}
+vec3 rgb_to_srgb(vec3 v) {
+    return vec3(rgb_to_srgb(v.x), rgb_to_srgb(v.y), rgb_to_srgb(v.z));
+}
+
+// same as includes/noise.inc.glsl of Render Pipeline
+vec3 rand_rgb(vec2 co) {
+    return abs(fract(sin(dot(co.xy, vec2(34.4835, 89.6372))) * vec3(29156.4765, 38273.5639, 47843.7546)));
+}
+)";
+
+const char* FRAGMENT_SHADER_RAND_RGB = R"(
+void main() {
+    vec2 texcoord = gl_FragCoord.xy / SCREEN_SIZE;
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    vec3 scene_color = rgb_to_srgb(texelFetch(ShadedScene, ivec3(coord, vr_eye), 0).xyz);
+    vec3 dither = (rand_rgb(texcoord) + rand_rgb(texcoord + 0.5787)) * 0.5 - 0.4;
+    scene_color += dither / 128.0;
+    result = vec4(scene_color, 1);
+}
+)";
+
+const char* FRAGMENT_SHADER_BLUE_NOISE = R"(
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    vec3 scene_color = rgb_to_srgb(texelFetch(ShadedScene, ivec3(coord, vr_eye), 0).xyz);
+    const ivec2 noise_size = textureSize(BlueNoiseTex, 0);
+    vec3 dither = texelFetch(BlueNoiseTex, (coord + blue_noise_offset) % noise_size, 0).xyz - 0.5;
+    scene_color += dither / 128.0;
+    result = vec4(scene_color, 1);
+}
+)";
+
+struct Options
+{
+    int width = 1440;           ///< per eye
+    int height = 1600;
+    int frame_count = 50;
+    int warmup_frame_count = 5;
+};
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string name = argv[k];
+        if (k + 1 >= argc)
+            return false;
+
+        const char* value = argv[++k];
+        try
+        {
+            if (name == "--width")
+                options.width = std::stoi(value);
+            else if (name == "--height")
+                options.height = std::stoi(value);
+            else if (name == "--frames")
+                options.frame_count = std::stoi(value);
+            else if (name == "--warmup")
+                options.warmup_frame_count = std::stoi(value);
+            else
+                return false;
+        }
+        catch (const std::exception&)
+        {
+            std::cerr << "Invalid value of " << name << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    return options.width > 0 && options.height > 0 && options.frame_count > 0 && options.warmup_frame_count >= 0;
+}
+
+bool create_context()
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // surfaceless platform does not need window system.
+    const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cerr << "Failed to initialize EGL display." << std::endl;
+        return false;
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &config_count) || config_count == 0)
+    {
+        // surfaceless display may not have pbuffer configs.
+        const EGLint surfaceless_config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        if (!eglChooseConfig(display, surfaceless_config_attribs, &config, 1, &config_count) || config_count == 0)
+        {
+            std::cerr << "Failed to choose EGL config." << std::endl;
+            return false;
+        }
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "Failed to bind OpenGL API." << std::endl;
+        return false;
+    }
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::cerr << "Failed to create OpenGL 4.3 context." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+GLuint compile_program(const char* fragment_body)
+{
+    const auto compile = [](GLenum type, const std::vector<const char*>& sources) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, static_cast<GLsizei>(sources.size()), sources.data(), nullptr);
+        glCompileShader(shader);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            char log[4096];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cerr << "Failed to compile shader:\n" << log << std::endl;
+        }
+        return shader;
+    };
+
+    const GLuint vertex_shader = compile(GL_VERTEX_SHADER, { VERTEX_SHADER });
+    const GLuint fragment_shader = compile(GL_FRAGMENT_SHADER, { FRAGMENT_SHADER_HEADER, fragment_body });
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        char log[4096];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cerr << "Failed to link program:\n" << log << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+/** Get the average time per frame (both eyes) in milliseconds. */
+double measure_ms(GLuint program, const Options& options)
+{
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "ShadedScene"), 0);
+    glUniform1i(glGetUniformLocation(program, "BlueNoiseTex"), 1);
+    glUniform2f(glGetUniformLocation(program, "SCREEN_SIZE"), static_cast<float>(options.width), static_cast<float>(options.height));
+    const GLint eye_location = glGetUniformLocation(program, "vr_eye");
+    const GLint offset_location = glGetUniformLocation(program, "blue_noise_offset");
+
+    std::chrono::steady_clock::time_point begin;
+    for (int frame = 0; frame < options.warmup_frame_count + options.frame_count; ++frame)
+    {
+        if (frame == options.warmup_frame_count)
+        {
+            glFinish();
+            begin = std::chrono::steady_clock::now();
+        }
+
+        // same as OpenVRRenderStage
+        glUniform2i(offset_location,
+            static_cast<int>(std::fmod(frame * 0.7548776662, 1.0) * BLUE_NOISE_SIZE),
+            static_cast<int>(std::fmod(frame * 0.5698402910, 1.0) * BLUE_NOISE_SIZE));
+
+        for (int eye = 0; eye < 2; ++eye)
+        {
+            glUniform1i(eye_location, eye);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+    glFinish();
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / options.frame_count;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "Usage: " << argv[0] << " [--width <int>] [--height <int>] [--frames <int>] [--warmup <int>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!create_context())
+        return EXIT_FAILURE;
+
+    std::cout << "GL_RENDERER: " << glGetString(GL_RENDERER) << "\n"
+        << "eye size: " << options.width << "x" << options.height << "\n";
+
+    // scene texture of both eyes
+    std::vector<float> scene(static_cast<size_t>(options.width) * options.height * 4 * 2);
+    std::mt19937 random_engine;
+    std::uniform_real_distribution<float> value(0.0f, 1.0f);
+    for (auto& v: scene)
+        v = value(random_engine);
+
+    GLuint scene_tex;
+    glGenTextures(1, &scene_tex);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, scene_tex);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, options.width, options.height, 2, 0, GL_RGBA, GL_FLOAT, scene.data());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    scene.clear();
+    scene.shrink_to_fit();
+
+    // blue noise texture same as BlueNoiseTexture::generate
+    const int noise_count = BLUE_NOISE_SIZE * BLUE_NOISE_SIZE;
+    std::vector<unsigned char> noise(noise_count * 3);
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        const auto ranks = rpplugins::BlueNoiseTexture::generate_ranks(BLUE_NOISE_SIZE, 1234u + channel);
+        for (int k = 0; k < noise_count; ++k)
+            noise[k * 3 + channel] = static_cast<unsigned char>(ranks[k] * 256 / noise_count);
+    }
+
+    GLuint noise_tex;
+    glGenTextures(1, &noise_tex);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, noise_tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, noise.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // 8-bit output target of one eye
+    GLuint color_tex;
+    glGenTextures(1, &color_tex);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, color_tex);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, options.width, options.height);
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_tex, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Framebuffer is incomplete." << std::endl;
+        return EXIT_FAILURE;
+    }
+    glViewport(0, 0, options.width, options.height);
+
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    const GLuint rand_rgb_program = compile_program(FRAGMENT_SHADER_RAND_RGB);
+    const GLuint blue_noise_program = compile_program(FRAGMENT_SHADER_BLUE_NOISE);
+    if (!rand_rgb_program || !blue_noise_program)
+        return EXIT_FAILURE;
+
+    const double rand_rgb_ms = measure_ms(rand_rgb_program, options);
+    const double blue_noise_ms = measure_ms(blue_noise_program, options);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cerr << "OpenGL error occurred." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "rand_rgb: " << rand_rgb_ms << " ms/frame\n"
+        << "blue noise: " << blue_noise_ms << " ms/frame (x" << rand_rgb_ms / blue_noise_ms << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,362 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Benchmark of the per-frame CPU work of OpenVR plugin without HMD.
+ *
+ * Fake VR system generates events and noisy poses of simulated devices,
+ * and OpenVRFrameUpdater used in the update task of the plugin processes them:
+ * dispatching events to the handlers of the plugin, updating device nodes from poses,
+ * and reading changed properties through the property cache like applications.
+ *
+ * The time and the number of allocations per frame are reported, and the exit code is non-zero
+ * if they are over budget.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <openvr.h>
+
+#include "openvr_frame_updater.hpp"
+
+// ************************************************************************************************
+// allocation counter
+
+static std::atomic<uint64_t> allocation_count{ 0 };
+
+void* operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+
+// ************************************************************************************************
+// fake VR system
+
+/**
+ * Fake of vr::IVRSystem having only the functions used by OpenVRFrameUpdater in the benchmark.
+ *
+ * IVRSystem has many pure virtual functions depending on the version of OpenVR,
+ * so this is not derived from it and used as template argument.
+ */
+class FakeVRSystem
+{
+public:
+    FakeVRSystem(uint32_t device_count, float event_rate, float pose_noise) :
+        device_count_(device_count), event_rate_(event_rate)
+    {
+        // generate noisy poses in advance, so that the cost of random numbers is not measured.
+        std::normal_distribution<float> noise(0.0f, pose_noise);
+        poses_.resize(POSE_FRAME_COUNT * vr::k_unMaxTrackedDeviceCount);
+        for (size_t frame = 0; frame < POSE_FRAME_COUNT; ++frame)
+        {
+            for (uint32_t k = 0; k < vr::k_unMaxTrackedDeviceCount; ++k)
+            {
+                auto& pose = poses_[frame * vr::k_unMaxTrackedDeviceCount + k];
+                std::memset(&pose, 0, sizeof(pose));
+                if (k >= device_count_)
+                    continue;
+
+                auto& m = pose.mDeviceToAbsoluteTracking.m;
+                for (int i = 0; i < 3; ++i)
+                {
+                    for (int j = 0; j < 3; ++j)
+                        m[i][j] = (i == j ? 1.0f : 0.0f) + noise(random_engine_);
+                }
+                m[0][3] = 0.1f * k + noise(random_engine_);
+                m[1][3] = 1.5f + noise(random_engine_);
+                m[2][3] = noise(random_engine_);
+
+                pose.eTrackingResult = vr::TrackingResult_Running_OK;
+                pose.bPoseIsValid = true;
+                pose.bDeviceIsConnected = true;
+            }
+        }
+    }
+
+    /** Schedule the events and poses of next frame. */
+    void next_frame()
+    {
+        pose_frame_index_ = (pose_frame_index_ + 1) % POSE_FRAME_COUNT;
+
+        event_accumulator_ += event_rate_;
+        pending_event_count_ = static_cast<uint32_t>(event_accumulator_);
+        event_accumulator_ -= pending_event_count_;
+    }
+
+    /** Get the poses of current frame like IVRCompositor::WaitGetPoses without waiting. */
+    const vr::TrackedDevicePose_t* get_poses() const
+    {
+        return &poses_[pose_frame_index_ * vr::k_unMaxTrackedDeviceCount];
+    }
+
+    bool PollNextEvent(vr::VREvent_t* pEvent, uint32_t uncbVREvent)
+    {
+        if (pending_event_count_ == 0 || uncbVREvent != sizeof(vr::VREvent_t))
+            return false;
+        --pending_event_count_;
+
+        static const uint32_t event_types[] = {
+            vr::VREvent_ButtonPress,            // messenger only
+            vr::VREvent_ButtonUnpress,          // messenger only
+            vr::VREvent_ButtonTouch,            // messenger only
+            vr::VREvent_PropertyChanged,
+        };
+
+        std::memset(pEvent, 0, sizeof(vr::VREvent_t));
+        pEvent->eventType = event_types[event_index_++ % (sizeof(event_types) / sizeof(event_types[0]))];
+        pEvent->trackedDeviceIndex = std::uniform_int_distribution<uint32_t>(0, device_count_ - 1)(random_engine_);
+        if (pEvent->eventType == vr::VREvent_PropertyChanged)
+            pEvent->data.property.prop = vr::Prop_ModelNumber_String;
+        return true;
+    }
+
+    uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty,
+        char* pchValue, uint32_t unBufferSize, vr::ETrackedPropertyError* pError)
+    {
+        // longer than small string buffer, so copying it allocates memory.
+        static const char value[] = "Fake Controller Model Number";
+
+        if (unDeviceIndex >= device_count_)
+        {
+            *pError = vr::TrackedProp_InvalidDevice;
+            return 0;
+        }
+
+        if (unBufferSize < sizeof(value))
+        {
+            *pError = vr::TrackedProp_BufferTooSmall;
+            return sizeof(value);
+        }
+
+        *pError = vr::TrackedProp_Success;
+        std::memcpy(pchValue, value, sizeof(value));
+        return sizeof(value);
+    }
+
+private:
+    uint32_t device_count_;
+    float event_rate_;
+    float event_accumulator_ = 0;
+    uint32_t pending_event_count_ = 0;
+    uint32_t event_index_ = 0;
+
+    static constexpr size_t POSE_FRAME_COUNT = 16;
+    std::vector<vr::TrackedDevicePose_t> poses_;
+    size_t pose_frame_index_ = 0;
+
+    std::mt19937 random_engine_;
+};
+
+// ************************************************************************************************
+
+struct Options
+{
+    uint32_t device_count = 8;
+    float event_rate = 2.0f;                ///< events per frame
+    float pose_noise = 0.001f;              ///< standard deviation of pose elements
+    float epsilon = 0.0f;                   ///< device_position_epsilon and device_orientation_epsilon
+    uint64_t frame_count = 10000;
+    uint64_t warmup_frame_count = 100;
+    double budget_ns = 20000.0;             ///< per frame
+    double allocation_budget = 0.0;         ///< per frame
+};
+
+void print_usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --devices <1-64>          number of simulated devices (default: 8)\n"
+        << "  --event-rate <float>      events per frame (default: 2)\n"
+        << "  --pose-noise <float>      standard deviation of pose noise (default: 0.001)\n"
+        << "  --epsilon <float>         thresholds of device node update (default: 0)\n"
+        << "  --frames <int>            measured frames (default: 10000)\n"
+        << "  --warmup <int>            frames before measurement (default: 100)\n"
+        << "  --budget-ns <float>       time budget per frame in nanoseconds (default: 20000)\n"
+        << "  --alloc-budget <float>    allocation budget per frame (default: 0)\n";
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string name = argv[k];
+        if (name == "--help" || name == "-h" || k + 1 >= argc)
+            return false;
+
+        const char* value = argv[++k];
+        try
+        {
+            if (name == "--devices")
+                options.device_count = static_cast<uint32_t>(std::stoul(value));
+            else if (name == "--event-rate")
+                options.event_rate = std::stof(value);
+            else if (name == "--pose-noise")
+                options.pose_noise = std::stof(value);
+            else if (name == "--epsilon")
+                options.epsilon = std::stof(value);
+            else if (name == "--frames")
+                options.frame_count = std::stoull(value);
+            else if (name == "--warmup")
+                options.warmup_frame_count = std::stoull(value);
+            else if (name == "--budget-ns")
+                options.budget_ns = std::stod(value);
+            else if (name == "--alloc-budget")
+                options.allocation_budget = std::stod(value);
+            else
+                return false;
+        }
+        catch (const std::exception&)
+        {
+            std::cerr << "Invalid value of " << name << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (options.device_count < 1 || options.device_count > vr::k_unMaxTrackedDeviceCount)
+    {
+        std::cerr << "The number of devices should be in [1, " << vr::k_unMaxTrackedDeviceCount << "]" << std::endl;
+        return false;
+    }
+
+    if (options.event_rate < 0 || options.pose_noise < 0 || options.epsilon < 0 || options.frame_count == 0)
+        return false;
+
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FakeVRSystem vr_system(options.device_count, options.event_rate, options.pose_noise);
+
+    rpplugins::OpenVRFrameUpdater<FakeVRSystem> updater;
+    updater.vr_system_ = &vr_system;
+    updater.device_position_epsilon_ = options.epsilon;
+    updater.device_orientation_epsilon_ = options.epsilon;
+
+    NodePath device_node_group("device_node_group");
+    for (uint32_t k = 0; k < options.device_count; ++k)
+    {
+        updater.device_nodes_[k] = device_node_group.attach_new_node("device" + std::to_string(k));
+
+        // the plugin reads the property when it sets up the device node.
+        vr::ETrackedPropertyError err;
+        updater.get_string_property(k, vr::Prop_ModelNumber_String, err);
+    }
+
+    // handler of application reading changed property.
+    size_t model_number_length = 0;
+    updater.event_dispatcher_.add_handler(vr::VREvent_PropertyChanged, [&](const vr::VREvent_t& vr_event) {
+        vr::ETrackedPropertyError err;
+        if (auto model_number = updater.get_string_property(vr_event.trackedDeviceIndex, vr_event.data.property.prop, err))
+            model_number_length += model_number->size();
+    });
+
+    uint64_t event_count = 0;
+
+    // same order as the update task of the plugin.
+    const auto run_frame = [&]() {
+        vr_system.next_frame();
+
+        updater.update_poses(vr_system.get_poses(), true);
+        updater.process_events([&](const vr::VREvent_t&) { ++event_count; });
+    };
+
+    for (uint64_t k = 0; k < options.warmup_frame_count; ++k)
+        run_frame();
+
+    event_count = 0;
+    const auto begin_stats = updater.device_update_stats_;
+    const uint64_t begin_allocation_count = allocation_count.load(std::memory_order_relaxed);
+    const auto begin_time = std::chrono::steady_clock::now();
+
+    for (uint64_t k = 0; k < options.frame_count; ++k)
+        run_frame();
+
+    const auto end_time = std::chrono::steady_clock::now();
+    const uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - begin_allocation_count;
+    const auto& end_stats = updater.device_update_stats_;
+
+    const double ns_per_frame = std::chrono::duration<double, std::nano>(end_time - begin_time).count() / options.frame_count;
+    const double allocations_per_frame = static_cast<double>(allocations) / options.frame_count;
+    const double updated_per_frame = static_cast<double>(end_stats.total_updated_count - begin_stats.total_updated_count) / options.frame_count;
+    const double skipped_per_frame = static_cast<double>(end_stats.total_skipped_count - begin_stats.total_skipped_count) / options.frame_count;
+
+    // use results to keep the work from optimization.
+    volatile float sink = updater.device_mats_[0](3, 0) + static_cast<float>(model_number_length);
+    (void)sink;
+
+    std::cout << "devices: " << options.device_count
+        << ", events/frame: " << static_cast<double>(event_count) / options.frame_count
+        << ", pose noise: " << options.pose_noise
+        << ", epsilon: " << options.epsilon << "\n"
+        << "device nodes: " << updated_per_frame << " updated, " << skipped_per_frame << " skipped /frame\n"
+        << "time: " << ns_per_frame << " ns/frame (budget: " << options.budget_ns << ")\n"
+        << "allocations: " << allocations_per_frame << " /frame (budget: " << options.allocation_budget << ")" << std::endl;
+
+    bool over_budget = false;
+    if (ns_per_frame > options.budget_ns)
+    {
+        std::cerr << "Time is over budget." << std::endl;
+        over_budget = true;
+    }
+    if (allocations_per_frame > options.allocation_budget)
+    {
+        std::cerr << "Allocations are over budget." << std::endl;
+        over_budget = true;
+    }
+
+    return over_budget ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Check of pose conversion.
+ *
+ * OpenVRPlugin::convert_pose_matrix and the SSE version used in the plugin are compared with
+ * `z_to_y_up_mat() * convert_matrix(m) * y_to_z_up_mat()` for random matrices.
+ * The exit code is non-zero if they are different.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include <openvr.h>
+
+#include "rpplugins/openvr/plugin.hpp"
+
+#include "openvr_pose_conversion.hpp"
+
+using rpplugins::OpenVRPlugin;
+
+namespace {
+
+constexpr int TEST_COUNT = 10000;
+constexpr float THRESHOLD = 1e-4f;
+
+LMatrix4 reference_convert_pose_matrix(const vr::HmdMatrix34_t& from, float distance_scale)
+{
+    LMatrix4 result = LMatrix4::z_to_y_up_mat() * OpenVRPlugin::convert_matrix(from) * LMatrix4::y_to_z_up_mat();
+    result.set_row(3, result.get_row3(3) * distance_scale);
+    return result;
+}
+
+}
+
+int main()
+{
+    std::mt19937 random_engine;
+    std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+
+    int failed_count = 0;
+    vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount] = {};
+    LMatrix4 fast_results[vr::k_unMaxTrackedDeviceCount];
+
+    for (int k = 0; k < TEST_COUNT; ++k)
+    {
+        for (auto& pose : poses)
+        {
+            for (auto& row : pose.mDeviceToAbsoluteTracking.m)
+            {
+                for (auto& v : row)
+                    v = value(random_engine);
+            }
+        }
+
+        const float distance_scale = scale(random_engine);
+        rpplugins::fast_convert_pose_matrices(poses, fast_results, vr::k_unMaxTrackedDeviceCount, distance_scale);
+
+        for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i)
+        {
+            const auto& from = poses[i].mDeviceToAbsoluteTracking;
+            const LMatrix4 reference = reference_convert_pose_matrix(from, distance_scale);
+
+            LMatrix4 result;
+            OpenVRPlugin::convert_pose_matrix(from, result, distance_scale);
+
+            if (!result.almost_equal(reference, THRESHOLD) || !fast_results[i].almost_equal(reference, THRESHOLD))
+            {
+                if (failed_count == 0)
+                {
+                    std::cerr << "Reference:\n" << reference
+                        << "\nconvert_pose_matrix:\n" << result
+                        << "\nfast_convert_pose_matrix:\n" << fast_results[i] << std::endl;
+                }
+                ++failed_count;
+            }
+        }
+    }
+
+#ifdef RPPLUGINS_OPENVR_USE_SSE
+    std::cout << "SSE: enabled\n";
+#else
+    std::cout << "SSE: disabled\n";
+#endif
+    std::cout << "failed: " << failed_count << " / " << TEST_COUNT * vr::k_unMaxTrackedDeviceCount << std::endl;
+
+    return failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,180 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Benchmark of render model conversion.
+ *
+ * The vertex conversion and the swizzle of texture in OpenVRRenderModelLoader are run
+ * with scalar and SSE2 versions on a synthetic large model, and the results are compared.
+ * The exit code is non-zero if the results are different.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <openvr.h>
+
+#include "openvr_render_model_conversion.hpp"
+
+namespace {
+
+struct Options
+{
+    size_t vertex_count = 200000;
+    size_t texture_size = 2048;
+    int iteration_count = 20;
+};
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string name = argv[k];
+        if (k + 1 >= argc)
+            return false;
+
+        const char* value = argv[++k];
+        try
+        {
+            if (name == "--vertices")
+                options.vertex_count = std::stoul(value);
+            else if (name == "--texture-size")
+                options.texture_size = std::stoul(value);
+            else if (name == "--iterations")
+                options.iteration_count = std::stoi(value);
+            else
+                return false;
+        }
+        catch (const std::exception&)
+        {
+            std::cerr << "Invalid value of " << name << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    return options.vertex_count > 0 && options.texture_size > 0 && options.iteration_count > 0;
+}
+
+/** Get the minimum time of iterations in microseconds. */
+template <class Func>
+double measure_us(int iteration_count, Func&& func)
+{
+    double min_us = (std::numeric_limits<double>::max)();
+    for (int k = 0; k < iteration_count; ++k)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        func();
+        const auto end = std::chrono::steady_clock::now();
+        min_us = (std::min)(min_us, std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    return min_us;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "Usage: " << argv[0] << " [--vertices <int>] [--texture-size <int>] [--iterations <int>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 random_engine;
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    std::vector<vr::RenderModel_Vertex_t> vertices(options.vertex_count);
+    for (auto& vertex: vertices)
+    {
+        for (auto& v: vertex.vPosition.v)
+            v = value(random_engine);
+        for (auto& v: vertex.vNormal.v)
+            v = value(random_engine);
+        for (auto& v: vertex.rfTextureCoord)
+            v = value(random_engine);
+    }
+
+    const size_t pixel_count = options.texture_size * options.texture_size;
+    std::vector<uint8_t> pixels(pixel_count * 4);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& p: pixels)
+        p = static_cast<uint8_t>(byte(random_engine));
+
+    std::vector<float> scalar_vertices(options.vertex_count * 8);
+    std::vector<uint8_t> scalar_pixels(pixels.size());
+
+    const double vertices_scalar_us = measure_us(options.iteration_count, [&]() {
+        rpplugins::convert_render_model_vertices_scalar(vertices.data(), scalar_vertices.data(), vertices.size());
+    });
+    const double swizzle_scalar_us = measure_us(options.iteration_count, [&]() {
+        rpplugins::swizzle_red_blue_scalar(pixels.data(), scalar_pixels.data(), pixel_count);
+    });
+
+    std::cout << "vertices: " << options.vertex_count << ", texture: " << options.texture_size << "x" << options.texture_size << "\n"
+        << "convert vertices (scalar): " << vertices_scalar_us << " us\n"
+        << "swizzle texture (scalar): " << swizzle_scalar_us << " us\n";
+
+    bool succeeded = true;
+
+#if defined(OPENVR_RENDER_MODEL_USE_SSE2)
+    std::vector<float> sse2_vertices(scalar_vertices.size());
+    std::vector<uint8_t> sse2_pixels(pixels.size());
+
+    const double vertices_sse2_us = measure_us(options.iteration_count, [&]() {
+        rpplugins::convert_render_model_vertices_sse2(vertices.data(), sse2_vertices.data(), vertices.size());
+    });
+    const double swizzle_sse2_us = measure_us(options.iteration_count, [&]() {
+        rpplugins::swizzle_red_blue_sse2(pixels.data(), sse2_pixels.data(), pixel_count);
+    });
+
+    std::cout << "convert vertices (SSE2): " << vertices_sse2_us << " us (x" << vertices_scalar_us / vertices_sse2_us << ")\n"
+        << "swizzle texture (SSE2): " << swizzle_sse2_us << " us (x" << swizzle_scalar_us / swizzle_sse2_us << ")\n";
+
+    if (std::memcmp(scalar_vertices.data(), sse2_vertices.data(), scalar_vertices.size() * sizeof(float)) != 0)
+    {
+        std::cerr << "Converted vertices are different." << std::endl;
+        succeeded = false;
+    }
+
+    if (scalar_pixels != sse2_pixels)
+    {
+        std::cerr << "Swizzled textures are different." << std::endl;
+        succeeded = false;
+    }
+#else
+    std::cout << "SSE2: disabled\n";
+#endif
+
+    std::cout << std::flush;
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -22,11 +22,18 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <cfloat>
+
 #include <boost/dll/alias.hpp>
 
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/pluginbase/manager.hpp>
 #include <render_pipeline/rpcore/pluginbase/setting_types.hpp>
 
 #include <rpplugins/rpstat/gui_interface.hpp>
+#include <rpplugins/openvr/plugin.hpp>
 
 namespace rpplugins {
 
@@ -40,8 +47,16 @@ public:
     void on_draw_new_frame() override;
 
 private:
+    void draw_frame_timing();
+    void draw_frame_timing_graph(const char* label, float OpenVRPlugin::FrameTiming::*member);
+
     bool is_open_ = false;
 
+    OpenVRPlugin* plugin_ = nullptr;
+    std::vector<OpenVRPlugin::FrameTiming> frame_timings_;
+    std::vector<float> frame_timing_values_;
+    std::vector<float> sorted_frame_timing_values_;
+
     rpcore::FloatType* distance_scale_;
     rpcore::BoolType* update_camera_pose_;
     rpcore::BoolType* update_eye_pose_;
@@ -54,6 +69,9 @@ PluginGUI::PluginGUI(rpcore::RenderPipeline& pipeline): GUIInterface(pipeline, R
     distance_scale_ = get_setting_handle<rpcore::FloatType>("distance_scale");
     update_camera_pose_ = get_setting_handle<rpcore::BoolType>("update_camera_pose");
     update_eye_pose_ = get_setting_handle<rpcore::BoolType>("update_eye_pose");
+
+    if (const auto& instance = plugin_mgr_->get_instance(plugin_id_))
+        plugin_ = static_cast<OpenVRPlugin*>(instance->downcast());
 }
 
 void PluginGUI::on_draw_menu()
@@ -91,9 +109,44 @@ void PluginGUI::on_draw_new_frame()
         plugin_mgr_->on_setting_changed(plugin_id_, "update_eye_pose");
     }
 
+    if (plugin_ && ImGui::CollapsingHeader("Frame Timing"))
+        draw_frame_timing();
+
     ImGui::End();
 }
 
+void PluginGUI::draw_frame_timing()
+{
+    const auto totals = plugin_->get_frame_timing_totals();
+    ImGui::Text("Frames: %llu", static_cast<unsigned long long>(totals.frame_count));
+    ImGui::Text("Dropped Frames: %llu", static_cast<unsigned long long>(totals.dropped_frames));
+    ImGui::Text("Reprojected Frames: %llu", static_cast<unsigned long long>(totals.reprojected_frames));
+
+    plugin_->get_frame_timings(frame_timings_);
+    if (frame_timings_.empty())
+        return;
+
+    draw_frame_timing_graph("CPU (ms)", &OpenVRPlugin::FrameTiming::cpu_frame_ms);
+    draw_frame_timing_graph("GPU (ms)", &OpenVRPlugin::FrameTiming::gpu_frame_ms);
+    draw_frame_timing_graph("Submit to Present (ms)", &OpenVRPlugin::FrameTiming::submit_to_present_ms);
+}
+
+void PluginGUI::draw_frame_timing_graph(const char* label, float OpenVRPlugin::FrameTiming::*member)
+{
+    frame_timing_values_.resize(frame_timings_.size());
+    std::transform(frame_timings_.begin(), frame_timings_.end(), frame_timing_values_.begin(),
+        [member](const OpenVRPlugin::FrameTiming& timing) { return timing.*member; });
+
+    // 99th percentile in the history
+    sorted_frame_timing_values_ = frame_timing_values_;
+    const auto p99 = sorted_frame_timing_values_.begin() + (sorted_frame_timing_values_.size() - 1) * 99 / 100;
+    std::nth_element(sorted_frame_timing_values_.begin(), p99, sorted_frame_timing_values_.end());
+
+    const std::string overlay = fmt::format("last: {:.2f}, p99: {:.2f}", frame_timing_values_.back(), *p99);
+    ImGui::PlotLines(label, frame_timing_values_.data(), static_cast<int>(frame_timing_values_.size()),
+        0, overlay.c_str(), 0.0f, FLT_MAX, ImVec2(0, 60));
+}
+
 }
 
 RPPLUGINS_GUI_CREATOR(rpplugins::PluginGUI)